@@ -0,0 +1,74 @@
+// Throughput of HyperLogLog::add with the ntHash and packed backends on the same sequences.
+// usage: bench_hash_backends [FASTA/FASTQ[.gz]] [k = 31] [b = 16] [repetitions = 5]
+// Without a file, 400k random 150 bp reads are sketched. Sequences are loaded first, so parsing is not timed.
+#include "../lib/include/HyperLogLog.hpp"
+#include "../lib/include/FastxStream.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+std::vector<std::string> load(std::string const& filename, const std::size_t k)
+{
+    gzFile fp = gzopen(filename.c_str(), "r");
+    if (fp == NULL) throw std::runtime_error("unable to open " + filename);
+    std::vector<std::string> sequences;
+    {
+        sketching::FastxStream stream(fp, std::size_t(1) << 22, k - 1);
+        sketching::FastxStream::piece_t piece;
+        while (stream.next(piece)) sequences.push_back(std::move(piece.data));
+    }
+    gzclose(fp);
+    return sequences;
+}
+
+std::vector<std::string> random_reads(const std::size_t nreads, const std::size_t length)
+{
+    static constexpr char bases[] = "ACGT";
+    std::mt19937_64 rng(33);
+    std::vector<std::string> reads(nreads, std::string(length, 'A'));
+    for (auto& read : reads) {
+        for (auto& c : read) c = bases[rng() & 3];
+    }
+    return reads;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    using namespace sketching;
+    const std::string filename = argc > 1 ? argv[1] : "";
+    const std::size_t k = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 31;
+    const std::size_t b = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16;
+    const std::size_t repetitions = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 5;
+    if (k == 0 or k > 32) throw std::invalid_argument("k should be in [1, 32] to compare with the packed backend");
+    if (repetitions == 0) throw std::invalid_argument("at least one repetition is needed");
+
+    const auto sequences = filename == "" ? random_reads(400000, 150) : load(filename, k);
+    std::size_t bases = 0;
+    for (auto const& seq : sequences) bases += seq.size();
+
+    std::cout << "backend\tk\tb\tbases\tseconds\tMbases_per_second\testimate\n";
+    for (auto backend : {HashBackend::nthash, HashBackend::packed}) {
+        double best = 0;
+        std::size_t estimate = 0;
+        for (std::size_t r = 0; r < repetitions; ++r) { // fastest run, the others are noise
+            HyperLogLog hll(static_cast<uint8_t>(k), static_cast<uint8_t>(b), backend);
+            const auto start = std::chrono::steady_clock::now();
+            for (auto const& seq : sequences) hll.add(seq.data(), seq.size());
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (r == 0 or seconds < best) best = seconds;
+            estimate = hll.count();
+        }
+        std::cout << to_string(backend) << "\t" << k << "\t" << b << "\t" << bases << "\t" << best << "\t" << bases / best / 1e6 << "\t" << estimate << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,4 @@
+#include <argparse/argparse.hpp>
+
+argparse::ArgumentParser get_parser_range();
+int range_main(const argparse::ArgumentParser& parser);
@@ -0,0 +1,4 @@
+#include <argparse/argparse.hpp>
+
+argparse::ArgumentParser get_parser_records();
+int records_main(const argparse::ArgumentParser& parser);
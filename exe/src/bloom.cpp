@@ -0,0 +1,81 @@
+#include "../include/bloom.hpp"
+#include "../../lib/include/HyperLogLog.hpp"
+#include "../../lib/include/KmerHasher.hpp"
+#include "../../lib/include/BlockedBloomFilter.hpp"
+#include "../../lib/include/RegisterMemory.hpp"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <zlib.h>
+extern "C" {
+#include "../include/kseq.h"
+}
+
+KSEQ_INIT(gzFile, gzread)
+
+int bloom_main(const argparse::ArgumentParser& parser)
+{
+    using namespace sketching;
+    auto k = parser.get<std::size_t>("-k");
+    auto backend = hash_backend_from_string(parser.get<std::string>("--hash"));
+    auto references = parser.get<std::vector<std::string>>("references");
+    auto output_filename = parser.get<std::string>("--output");
+    auto bytes = memory::parse_size(parser.get<std::string>("--memory"));
+    auto probes = parser.get<std::size_t>("--probes");
+    if (references.empty()) throw std::invalid_argument("no reference given");
+    if (probes > 7) throw std::invalid_argument("number of probes should be in [1, 7]");
+    if (k == 0 or k > 64) throw std::invalid_argument("k-mer size should be in [1, 64]");
+
+    // the reference k-mers go through the same hashing as build, HLL registers count them to report the false positive rate
+    const KmerHasher hasher(uint8_t(k), backend);
+    BlockedBloomFilter filter(bytes, hasher.kmer_length(), backend, probes);
+    constexpr uint8_t b = 14;
+    std::vector<uint8_t> registers(std::size_t(1) << b, 0);
+    std::size_t total = 0;
+    auto insert = [&](const uint64_t h0, const uint64_t h1) noexcept {
+        filter.insert(h0, h1);
+        const auto update = HyperLogLog::register_and_rank(h0, h1, b);
+        registers[update.index] = std::max(registers[update.index], update.rank);
+        ++total;
+    };
+    for (auto const& reference : references) {
+        gzFile fp = gzopen(reference.c_str(), "r");
+        if (fp == NULL) throw std::runtime_error("unable to open " + reference);
+        kseq_t* seq = kseq_init(fp);
+        while (kseq_read(seq) >= 0) hasher.for_each_hash(seq->seq.s, seq->seq.l, insert);
+        kseq_destroy(seq);
+        gzclose(fp);
+    }
+    filter.store(output_filename);
+    const HyperLogLog hll(hasher.kmer_length(), b, backend, registers.data(), total);
+    const auto distinct = hll.count();
+    std::cerr << distinct << "," << hll.size() << "," << filter.false_positive_rate(distinct) << "\n";
+    return 0;
+}
+
+argparse::ArgumentParser get_parser_bloom()
+{
+    argparse::ArgumentParser parser("bloom");
+    parser.add_description("Build a Bloom filter of reference k-mers for build --exclude (prints distinct k-mers,total k-mers,false positive rate)");
+    parser.add_argument("references")
+        .help("FASTA/FASTQ files of the k-mers to exclude")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-k")
+        .help("k-mer size, must match the sketches using the filter")
+        .scan<'u', std::size_t>()
+        .required();
+    parser.add_argument("--hash")
+        .help("k-mer hash backend, must match the sketches using the filter: nthash or packed [nthash]")
+        .default_value(std::string("nthash"));
+    parser.add_argument("-o", "--output")
+        .help("output filter file")
+        .required();
+    parser.add_argument("-m", "--memory")
+        .help("filter size, e.g. 512M or 4G. About 10 bits per reference k-mer give 1% false positives [1G]")
+        .default_value(std::string("1G"));
+    parser.add_argument("--probes")
+        .help("bits set per k-mer, in [1, 7] [6]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(6));
+    return parser;
+}
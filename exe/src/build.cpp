@@ -1,7 +1,23 @@
 #include "../include/build.hpp"
 #include "../../lib/include/HyperLogLog.hpp"
+#include "../../lib/include/WorkStealingPool.hpp"
+#include "../../lib/include/FastxStream.hpp"
+#include "../../lib/include/ValidRuns.hpp"
+#include "../../lib/include/AbundanceFilter.hpp"
+#include "../../lib/include/SpectrumSketch.hpp"
+#include "../../lib/include/BlockedBloomFilter.hpp"
+#include "../../lib/include/WindowProfile.hpp"
+#include "../../lib/include/SlidingHyperLogLog.hpp"
+#include "../../lib/include/RangeSketches.hpp"
+#include <chrono>
+#include <csignal>
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <sstream>
 #include <zlib.h>
 extern "C" {
 #include "../include/kseq.h"
@@ -9,16 +25,245 @@ extern "C" {
 
 KSEQ_INIT(gzFile, gzread)
 
+namespace {
+
+volatile std::sig_atomic_t checkpoint_requested = 0;
+
+void request_checkpoint(int)
+{
+    checkpoint_requested = 1;
+}
+
+// uncompressed offset of the first record not yet returned by kseq_read
+uint64_t parser_offset(gzFile fp, kseq_t const* seq)
+{
+    uint64_t offset = gztell(fp) - (seq->f->end - seq->f->begin);
+    if (seq->last_char != 0) --offset; // header character of the next record already consumed
+    return offset;
+}
+
+void store_checkpoint(std::string const& checkpoint_filename, std::vector<sketching::HyperLogLog> const& hlls, uint64_t records, uint64_t offset)
+{
+    const std::string tmp_filename = checkpoint_filename + ".tmp";
+    {
+        std::ofstream ostrm(tmp_filename, std::ios::binary);
+        ostrm.write(reinterpret_cast<const char*>(&records), sizeof(records));
+        ostrm.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        uint64_t nsketches = hlls.size();
+        ostrm.write(reinterpret_cast<const char*>(&nsketches), sizeof(nsketches));
+        for (auto const& hll : hlls) hll.store(ostrm);
+        if (not ostrm) throw std::runtime_error("unable to write checkpoint " + tmp_filename);
+    }
+    std::filesystem::rename(tmp_filename, checkpoint_filename); // atomic replacement of the previous checkpoint
+}
+
+std::vector<sketching::HyperLogLog> load_checkpoint(std::string const& checkpoint_filename, uint64_t& records, uint64_t& offset)
+{
+    std::ifstream istrm(checkpoint_filename, std::ios::binary);
+    uint64_t nsketches = 0;
+    istrm.read(reinterpret_cast<char*>(&records), sizeof(records));
+    istrm.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+    istrm.read(reinterpret_cast<char*>(&nsketches), sizeof(nsketches));
+    if (not istrm) throw std::runtime_error("corrupted checkpoint " + checkpoint_filename);
+    std::vector<sketching::HyperLogLog> hlls;
+    for (uint64_t i = 0; i < nsketches; ++i) hlls.emplace_back(istrm);
+    return hlls;
+}
+
+// sequences accumulated for the multi-lane hasher, storage is reused across batches
+struct sequence_batch_t {
+    std::string data;
+    std::vector<std::size_t> ends;
+    std::vector<std::string_view> views;
+
+    void push_back(char const* seq, std::size_t length)
+    {
+        data.append(seq, length);
+        ends.push_back(data.size());
+    }
+
+    bool full() const noexcept
+    {
+        return ends.size() >= 4096 or data.size() >= (std::size_t(1) << 22);
+    }
+
+    std::vector<std::string_view> const& get()
+    {
+        views.clear();
+        std::size_t start = 0;
+        for (auto end : ends) {
+            views.emplace_back(data.data() + start, end - start);
+            start = end;
+        }
+        return views;
+    }
+
+    void clear() noexcept
+    {
+        data.clear();
+        ends.clear();
+    }
+};
+
+// "31", "21,31,41" or "15:63:4" (start:stop:step, stop included), every k in [1, max_k] and given once
+std::vector<std::size_t> parse_kmer_lengths(std::string const& list, const std::size_t max_k)
+{
+    std::vector<std::size_t> ks;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        std::size_t start = 0, stop = 0, step = 1;
+        auto first = item.find(':');
+        if (first == std::string::npos) {
+            start = stop = std::stoull(item);
+        } else {
+            auto second = item.find(':', first + 1);
+            start = std::stoull(item.substr(0, first));
+            stop = std::stoull(item.substr(first + 1, second - first - 1));
+            if (second != std::string::npos) step = std::stoull(item.substr(second + 1));
+            if (step == 0) throw std::invalid_argument("k-mer range step should be > 0");
+        }
+        for (std::size_t k = start; k <= stop; k += step) {
+            if (k == 0 or k > max_k) throw std::invalid_argument("k-mer length " + std::to_string(k) + " should be in [1, " + std::to_string(max_k) + "]");
+            if (std::find(ks.begin(), ks.end(), k) != ks.end()) throw std::invalid_argument("k-mer length " + std::to_string(k) + " is given twice");
+            ks.push_back(k);
+            if (stop - k < step) break; // k += step would pass stop, or overflow
+        }
+    }
+    if (ks.empty()) throw std::invalid_argument("no k-mer length given");
+    return ks;
+}
+
+constexpr std::size_t chunk_kmers = std::size_t(1) << 20; // k-mers per task when a long record is split across threads
+
+// k-mers starting in [start, end) of a record, sketch i reads start .. end + k_i - 1
+void add_kmer_range(
+    std::vector<sketching::HyperLogLog>& hlls, 
+    std::vector<std::size_t> const& sketch_ks, 
+    std::vector<std::string> const& seeds, 
+    std::string const& record, 
+    std::size_t start, 
+    std::size_t end)
+{
+    if (not seeds.empty()) {
+        const std::size_t k = sketch_ks.front();
+        if (start + k > record.size()) return;
+        end = std::min(end, record.size() - k + 1);
+        sketching::HyperLogLog::add(hlls, seeds, record.data() + start, end - start + k - 1);
+        return;
+    }
+    for (std::size_t i = 0; i < hlls.size(); ++i) {
+        const std::size_t k = sketch_ks[i];
+        if (start + k > record.size()) continue;
+        const std::size_t last = std::min(end, record.size() - k + 1);
+        hlls[i].add(record.data() + start, last - start + k - 1);
+    }
+}
+
+// piece of a streamed record, k-mers lying entirely in the carried bases were added with the previous piece
+void add_stream_piece(
+    std::vector<sketching::HyperLogLog>& hlls, 
+    std::vector<std::size_t> const& sketch_ks, 
+    std::vector<std::string> const& seeds, 
+    sketching::FastxStream::piece_t const& piece)
+{
+    auto skip = [&piece](std::size_t k) {return piece.carry - std::min(piece.carry, k - 1);};
+    if (not seeds.empty()) {
+        const std::size_t k = sketch_ks.front();
+        const std::size_t offset = skip(k);
+        if (piece.data.size() >= offset + k) sketching::HyperLogLog::add(hlls, seeds, piece.data.data() + offset, piece.data.size() - offset);
+        return;
+    }
+    for (std::size_t i = 0; i < hlls.size(); ++i) {
+        const std::size_t offset = skip(sketch_ks[i]);
+        hlls[i].add(piece.data.data() + offset, piece.data.size() - offset);
+    }
+}
+
+void add_batch(
+    std::vector<sketching::HyperLogLog>& hlls, 
+    std::vector<std::size_t> const& sketch_ks, 
+    std::vector<std::string> const& seeds, 
+    bool ignore_short, 
+    std::vector<std::string_view> const& batch)
+{
+    if (seeds.empty()) {
+        for (auto& hll : hlls) hll.add(batch);
+        return;
+    }
+    for (auto const& s : batch) {
+        if (not (ignore_short and s.size() < sketch_ks.front())) sketching::HyperLogLog::add(hlls, seeds, s.data(), s.size());
+    }
+}
+
+// x.hll -> x.k31.hll or x.110111011.hll
+std::string per_sketch_filename(std::string const& sketch_filename, std::string const& tag)
+{
+    std::filesystem::path path(sketch_filename);
+    auto name = path.stem().string() + "." + tag + path.extension().string();
+    return (path.parent_path() / name).string();
+}
+
+} // namespace
+
 int build_main(const argparse::ArgumentParser& parser)
 {
     using namespace sketching;
-    auto k = parser.get<std::size_t>("-k");
     auto g = parser.get<bool>("--ignore-short-reads");
     auto b = parser.get<std::size_t>("-b");
     auto e = parser.get<double>("-e");
     auto passthrough = parser.get<bool>("--passthrough");
     auto input_filename = parser.get<std::string>("--input");
     auto sketch_filename = parser.get<std::string>("--sketch");
+    auto seeds = parser.get<std::vector<std::string>>("--seeds");
+    auto backend = hash_backend_from_string(parser.get<std::string>("--hash"));
+    auto ks = parse_kmer_lengths(parser.get<std::string>("-k"), backend == HashBackend::packed ? 32 : 64);
+    auto checkpoint_records = parser.get<std::size_t>("--checkpoint-records");
+    auto checkpoint_seconds = parser.get<std::size_t>("--checkpoint-seconds");
+    auto resume = parser.get<bool>("--resume");
+    auto stream = parser.get<bool>("--stream");
+    auto min_qual = parser.get<std::size_t>("--min-qual");
+    auto min_abundance = parser.get<std::size_t>("--min-abundance");
+    auto spectrum_size = parser.get<std::size_t>("--spectrum");
+    auto exclude_filename = parser.get<std::string>("--exclude");
+    auto window = parser.get<std::size_t>("--window");
+    auto window_step = parser.get<std::size_t>("--window-step");
+    auto bedgraph_filename = parser.get<std::string>("--bedgraph");
+    auto sliding = parser.get<std::size_t>("--sliding");
+    auto sliding_unit = parser.get<std::string>("--sliding-unit");
+    auto sliding_every = parser.get<std::size_t>("--sliding-every");
+    auto range_block = parser.get<std::size_t>("--range-block");
+    auto range_filename = parser.get<std::string>("--range-index");
+    auto& memory_options = memory::options();
+    if (parser.get<std::string>("--memory-budget") != "") memory_options.budget = memory::parse_size(parser.get<std::string>("--memory-budget"));
+    memory_options.huge_pages = memory::huge_pages_from_string(parser.get<std::string>("--huge-pages"));
+    memory_options.numa_node = memory::numa_from_string(parser.get<std::string>("--numa"));
+    const std::string checkpoint_filename = sketch_filename + ".ckpt";
+    const bool checkpointing = sketch_filename != "" and (checkpoint_records or checkpoint_seconds or resume);
+    if (not checkpointing and (checkpoint_records or checkpoint_seconds or resume)) {
+        throw std::invalid_argument("checkpoints require a sketch file (--sketch)");
+    }
+    if (stream and (passthrough or checkpointing)) {
+        throw std::invalid_argument("--stream does not keep whole records, it cannot be used with --passthrough or checkpoints");
+    }
+    if (stream and min_qual) throw std::invalid_argument("--stream skips quality strings, it cannot be used with --min-qual");
+    if (min_qual > 126 - 33) throw std::invalid_argument("--min-qual should be at most 93 (Phred+33)");
+    if (min_abundance == 0 or min_abundance > 255) throw std::invalid_argument("--min-abundance should be in [1, 255]");
+    if (min_abundance > 1 and checkpointing) throw std::invalid_argument("abundance counts are not checkpointed, --min-abundance cannot be used with checkpoints");
+    if (spectrum_size and (sketch_filename == "" or checkpointing)) throw std::invalid_argument("--spectrum requires --sketch and cannot be used with checkpoints");
+    if (window and (bedgraph_filename == "" or stream or checkpointing or not seeds.empty() or ks.size() != 1)) {
+        throw std::invalid_argument("--window requires --bedgraph and a single k, it cannot be used with --stream, spaced seeds or checkpoints");
+    }
+    if (window and (parser.get<std::size_t>("--window-bits") == 0 or parser.get<std::size_t>("--window-bits") > 16)) throw std::invalid_argument("--window-bits should be in [1, 16]");
+    if (sliding and (stream or checkpointing or not seeds.empty() or ks.size() != 1)) {
+        throw std::invalid_argument("--sliding requires a single k, it cannot be used with --stream, spaced seeds or checkpoints");
+    }
+    if (range_block and (range_filename == "" or stream or checkpointing or not seeds.empty() or ks.size() != 1)) {
+        throw std::invalid_argument("--range-block requires --range-index and a single k, it cannot be used with --stream, spaced seeds or checkpoints");
+    }
+    HyperLogLog::sanitize_b(b); // before narrowing
+    if (sliding) HyperLogLog::sanitize_b(parser.get<std::size_t>("--sliding-bits")); // before narrowing
+    if (sliding_unit != "reads" and sliding_unit != "seconds") throw std::invalid_argument("--sliding-unit should be reads or seconds");
 
     gzFile fp = NULL;
     if (input_filename == "") {
@@ -31,39 +276,299 @@ int build_main(const argparse::ArgumentParser& parser)
         }
     }
 
-    HyperLogLog hll;
-    if (sketch_filename != "" and std::filesystem::exists(sketch_filename)) {
-        hll = HyperLogLog::load(sketch_filename);
-    } else if (e < 0) {
-        hll = HyperLogLog(k, uint8_t(b));
+    const std::size_t min_k = *std::min_element(ks.begin(), ks.end()); // -g skips reads without a k-mer of any sketch
+    std::vector<std::size_t> sketch_ks; // one sketch per k, or one per spaced seed
+    std::vector<std::string> labels;
+    if (seeds.empty()) {
+        sketch_ks = ks;
+        for (auto k : ks) labels.push_back(std::to_string(k));
+    } else {
+        if (ks.size() != 1) throw std::invalid_argument("spaced seeds require a single k-mer length");
+        for (auto const& seed : seeds) {
+            if (seed.size() != ks[0] or seed.find_first_not_of("01") != std::string::npos) {
+                throw std::invalid_argument("spaced seed " + seed + " should be a string of 0s and 1s of length k");
+            }
+            sketch_ks.push_back(ks[0]);
+            labels.push_back(seed);
+        }
+    }
+    std::vector<std::string> sketch_filenames;
+    for (auto const& label : labels) {
+        if (labels.size() == 1) sketch_filenames.push_back(sketch_filename);
+        else sketch_filenames.push_back(per_sketch_filename(sketch_filename, seeds.empty() ? "k" + label : label));
+    }
+
+    std::vector<HyperLogLog> hlls;
+    uint64_t records = 0;
+    uint64_t resume_offset = 0;
+    const bool resuming = resume and std::filesystem::exists(checkpoint_filename);
+    if (resuming) {
+        hlls = load_checkpoint(checkpoint_filename, records, resume_offset);
+        if (hlls.size() != sketch_ks.size()) throw std::runtime_error("checkpoint does not match the given k-mer lengths or seeds");
     } else {
-        hll = HyperLogLog(k, e);
+        for (std::size_t i = 0; i < sketch_ks.size(); ++i) {
+            if (sketch_filename != "" and std::filesystem::exists(sketch_filenames[i])) {
+                hlls.push_back(HyperLogLog::load(sketch_filenames[i]));
+            } else if (e < 0) {
+                hlls.push_back(HyperLogLog(static_cast<uint8_t>(sketch_ks[i]), static_cast<uint8_t>(b), backend));
+            } else {
+                hlls.push_back(HyperLogLog(static_cast<uint8_t>(sketch_ks[i]), e, backend));
+            }
+        }
     }
 
-    kseq_t* seq = kseq_init(fp);
-    while (kseq_read(seq) >= 0) {
-        if (g and seq->seq.l < k) continue;
-        hll.add(seq->seq.s, seq->seq.l);
+    kseq_t* seq = NULL;
+    if (resuming) {
+        if (input_filename != "" and gzseek(fp, resume_offset, SEEK_SET) == static_cast<z_off_t>(resume_offset)) {
+            seq = kseq_init(fp); // gzip inputs are fast-skipped by zlib
+        } else { // non seekable input, skip already processed records
+            seq = kseq_init(fp);
+            for (uint64_t skipped = 0; skipped < records;) {
+                if (kseq_read(seq) < 0) throw std::runtime_error("input is shorter than the checkpoint");
+                if (not (g and seq->seq.l < min_k)) ++skipped; // reads ignored by -g are not records
+            }
+        }
+    } else {
+        seq = kseq_init(fp);
+    }
+    std::signal(SIGUSR1, request_checkpoint); // always caught, so that a build without checkpoints is not killed
+    auto ignore_checkpoint_request = [&]() {
+        if (not checkpoint_requested) return;
+        checkpoint_requested = 0;
+        std::cerr << "[build] SIGUSR1 ignored: checkpoints require --sketch and --checkpoint-records, --checkpoint-seconds or --resume\n";
+    };
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    auto nthreads = parser.get<std::size_t>("--threads");
+    if (nthreads == 0) nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (min_abundance > 1) { // one filter per sketch, shared by the copies of all threads
+        const std::size_t filter_bytes = memory::parse_size(parser.get<std::string>("--abundance-memory")) / hlls.size();
+        for (auto& hll : hlls) hll.set_abundance_filter(std::make_shared<AbundanceFilter>(filter_bytes, min_abundance, nthreads > 1));
+    }
+    if (exclude_filename != "") { // k-mers of the reference never reach the spectrum, the abundance counters nor the registers
+        auto reference = std::make_shared<BlockedBloomFilter const>(BlockedBloomFilter::load(exclude_filename));
+        if (not seeds.empty()) throw std::invalid_argument("--exclude does not support spaced seeds");
+        for (std::size_t i = 0; i < hlls.size(); ++i) {
+            if (reference->kmer_length() != sketch_ks[i] or reference->hash_backend() != hlls[i].hash_backend()) {
+                throw std::invalid_argument("bloom filter " + exclude_filename + " was built for k = " + std::to_string(reference->kmer_length()) + " and hash " + to_string(reference->hash_backend()));
+            }
+        }
+        auto exclusion = std::make_shared<ExclusionFilter>(reference);
+        for (auto& hll : hlls) hll.set_kmer_filter(exclusion);
+    }
+    std::vector<std::shared_ptr<SpectrumSketch>> spectra;
+    for (auto& hll : hlls) {
+        if (not spectrum_size) break;
+        spectra.push_back(std::make_shared<SpectrumSketch>(spectrum_size));
+        hll.set_spectrum(spectra.back());
+    }
+    // threaded builds: every worker fills its own copy of the sketches, merged into hlls by collect()
+    std::vector<std::vector<HyperLogLog>> partial;
+    std::unique_ptr<WorkStealingPool> pool;
+    if (nthreads > 1) {
+        for (std::size_t t = 0; t < nthreads; ++t) {
+            partial.push_back(hlls);
+            for (auto& hll : partial.back()) hll.reset();
+        }
+        pool = std::make_unique<WorkStealingPool>(nthreads, 4 * nthreads);
+    }
+    auto collect = [&]() {
+        if (not pool) return;
+        pool->wait();
+        for (auto& sketches : partial) {
+            for (std::size_t i = 0; i < hlls.size(); ++i) {
+                hlls[i] += sketches[i];
+                sketches[i].reset();
+            }
+        }
+    };
+    sequence_batch_t batch;
+    auto flush_batch = [&]() {
+        if (batch.ends.empty()) return;
+        if (pool) {
+            auto shared = std::make_shared<sequence_batch_t>(std::move(batch));
+            batch = sequence_batch_t();
+            pool->submit([&partial, &sketch_ks, &seeds, g, shared](std::size_t worker) {
+                add_batch(partial[worker], sketch_ks, seeds, g, shared->get());
+            });
+        } else {
+            for (auto& hll : hlls) hll.add(batch.get());
+            batch.clear();
+        }
+    };
+    auto add_record = [&](char const* sequence, std::size_t length) {
+        if (pool) {
+            if (length >= (std::size_t(1) << 16)) { // long records are split into chunks of k-mers, overlapping by k - 1 bases
+                auto record = std::make_shared<const std::string>(sequence, length);
+                for (std::size_t start = 0; start < record->size(); start += chunk_kmers) {
+                    pool->submit([&partial, &sketch_ks, &seeds, record, start](std::size_t worker) {
+                        add_kmer_range(partial[worker], sketch_ks, seeds, *record, start, start + chunk_kmers);
+                    });
+                }
+            } else {
+                batch.push_back(sequence, length);
+                if (batch.full()) flush_batch();
+            }
+        } else if (not seeds.empty()) { // all seeds rolled in one pass
+            HyperLogLog::add(hlls, seeds, sequence, length);
+        } else if (length >= (std::size_t(1) << 16)) { // long records are hashed in place
+            for (std::size_t i = 0; i < ks.size(); ++i) hlls[i].add(sequence, length); // parsing is shared across k
+        } else { // short records are hashed in batches, several reads at once
+            batch.push_back(sequence, length);
+            if (batch.full()) flush_batch();
+        }
+    };
+    if (stream) { // records are hashed piece by piece while being parsed
+        const std::size_t overlap = *std::max_element(sketch_ks.begin(), sketch_ks.end()) - 1;
+        FastxStream reader(fp, std::size_t(1) << 22, overlap);
+        FastxStream::piece_t piece;
+        while (reader.next(piece)) {
+            ignore_checkpoint_request(); // --stream is never checkpointed
+            if (g and piece.first and piece.last and piece.data.size() < min_k) continue; // as in the record loop
+            if (piece.first) ++records;
+            if (piece.first and piece.last) {
+                add_record(piece.data.data(), piece.data.size());
+            } else if (pool) {
+                auto shared = std::make_shared<const FastxStream::piece_t>(std::move(piece));
+                pool->submit([&partial, &sketch_ks, &seeds, shared](std::size_t worker) {
+                    add_stream_piece(partial[worker], sketch_ks, seeds, *shared);
+                });
+            } else {
+                add_stream_piece(hlls, sketch_ks, seeds, piece);
+            }
+        }
+        flush_batch();
+        collect();
+    }
+    std::unique_ptr<WindowProfile> profile;
+    std::ofstream bedgraph;
+    if (window) {
+        profile = std::make_unique<WindowProfile>(static_cast<uint8_t>(ks[0]), static_cast<uint8_t>(parser.get<std::size_t>("--window-bits")), backend, window, window_step ? window_step : window);
+        bedgraph.open(bedgraph_filename);
+        if (not bedgraph) throw std::runtime_error("unable to write " + bedgraph_filename);
+    }
+    auto add_profile = [&](char const* sequence, std::size_t length) {
+        if (not profile) return;
+        for (auto const& w : profile->profile(sequence, length)) {
+            bedgraph.write(seq->name.s, seq->name.l) << "\t" << w.start << "\t" << w.end << "\t" << w.estimate << "\n";
+        }
+    };
+    // sliding window over the most recent reads or seconds, reported every sliding_every units
+    std::unique_ptr<SlidingHyperLogLog> recent;
+    std::ofstream sliding_file;
+    std::ostream* sliding_report = &std::cerr;
+    const auto start_time = std::chrono::steady_clock::now();
+    uint64_t next_report = 0;
+    uint64_t reported_records = 0;
+    if (sliding) {
+        recent = std::make_unique<SlidingHyperLogLog>(static_cast<uint8_t>(ks[0]), static_cast<uint8_t>(parser.get<std::size_t>("--sliding-bits")), backend, sliding);
+        if (sliding_every == 0) sliding_every = sliding;
+        next_report = sliding_every;
+        if (parser.get<std::string>("--sliding-report") != "") {
+            sliding_file.open(parser.get<std::string>("--sliding-report"));
+            if (not sliding_file) throw std::runtime_error("unable to write " + parser.get<std::string>("--sliding-report"));
+            sliding_report = &sliding_file;
+        }
+        *sliding_report << sliding_unit << "\trecords\testimate\n";
+    }
+    auto report_sliding = [&]() {
+        *sliding_report << recent->time() << "\t" << records << "\t" << recent->count(sliding) << "\n" << std::flush;
+        reported_records = records;
+    };
+    auto add_sliding = [&](char const* sequence, std::size_t length) {
+        if (not recent) return;
+        const uint64_t now = sliding_unit == "reads" ? records : std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start_time).count();
+        recent->advance(now);
+        recent->add(sequence, length);
+        if (now >= next_report) {
+            report_sliding();
+            next_report = now + sliding_every;
+        }
+    };
+    // range sketches: hlls[0] only holds the current block, earlier blocks are merged into before_block
+    std::unique_ptr<RangeSketches> ranges;
+    HyperLogLog before_block;
+    if (range_block) {
+        ranges = std::make_unique<RangeSketches>(range_filename, range_block);
+        before_block = hlls[0];
+        hlls[0].reset();
+    }
+    auto close_block = [&](const uint64_t nrecords) {
+        flush_batch();
+        collect();
+        ranges->add_block(hlls[0], nrecords);
+        before_block += hlls[0];
+        hlls[0].reset();
+    };
+    std::string masked; // reused across records
+    while (not stream) {
+        if (checkpointing) { // state after the last processed record
+            bool due = checkpoint_requested or (checkpoint_records and records and records % checkpoint_records == 0);
+            if (not due and checkpoint_seconds and records % 1024 == 0) {
+                due = std::chrono::steady_clock::now() - last_checkpoint >= std::chrono::seconds(checkpoint_seconds);
+            }
+            if (due) {
+                flush_batch();
+                collect();
+                checkpoint_requested = 0;
+                store_checkpoint(checkpoint_filename, hlls, records, parser_offset(fp, seq));
+                last_checkpoint = std::chrono::steady_clock::now();
+            }
+        } else {
+            ignore_checkpoint_request();
+        }
+        if (kseq_read(seq) < 0) {
+            flush_batch();
+            collect();
+            break;
+        }
+        if (g and seq->seq.l < min_k) continue; // neither sketched nor passed through, not a record
+        ++records;
+        if (min_qual and seq->qual.l == seq->seq.l) { // low quality bases become N, the record itself stays untouched for passthrough
+            masked.resize(seq->seq.l);
+            mask_low_quality(seq->seq.s, seq->qual.s, seq->seq.l, static_cast<char>(33 + min_qual), &masked[0]);
+            add_record(masked.data(), masked.size());
+            add_profile(masked.data(), masked.size());
+            add_sliding(masked.data(), masked.size());
+        } else {
+            add_record(seq->seq.s, seq->seq.l);
+            add_profile(seq->seq.s, seq->seq.l);
+            add_sliding(seq->seq.s, seq->seq.l);
+        }
+        if (ranges and records % range_block == 0) close_block(range_block);
         if (passthrough) {
-            std::cout <<  ">" << std::string(seq->name.s, seq->name.l) << "\n";
-            std::cout << std::string(seq->seq.s, seq->seq.l) << "\n";
+            std::cout.put('>').write(seq->name.s, seq->name.l).put('\n'); // no temporary strings
+            std::cout.write(seq->seq.s, seq->seq.l).put('\n');
             if (seq->qual.l != 0) {
                 if (seq->qual.l != seq->seq.l) {
                     std::cerr << "sequence and its quality string do not match in length\n";
                 }
-                std::cout << "#\n";
-                std::cout << std::string(seq->qual.s, seq->qual.l) << "\n";
+                std::cout.write("#\n", 2);
+                std::cout.write(seq->qual.s, seq->qual.l).put('\n');
             }
         }
     }
+    if (recent and reported_records != records) report_sliding(); // state at the end of the input
+    if (ranges) {
+        if (records % range_block) close_block(records % range_block);
+        ranges->finish();
+        hlls[0] = before_block;
+    }
     if (seq) kseq_destroy(seq);
     gzclose(fp);
 
     if (sketch_filename != "") {
-        hll.store(sketch_filename);
+        for (std::size_t i = 0; i < hlls.size(); ++i) hlls[i].store(sketch_filenames[i]);
+        for (std::size_t i = 0; i < spectra.size(); ++i) { // x.hll -> x.spectrum.tsv
+            spectra[i]->store(std::filesystem::path(sketch_filenames[i]).replace_extension(".spectrum.tsv").string());
+        }
+        if (checkpointing) std::filesystem::remove(checkpoint_filename);
     }
 
-    std::cerr << hll.count() << "," << hll.size() << "\n";
+    if (hlls.size() == 1) {
+        std::cerr << hlls[0].count() << "," << hlls[0].size() << "\n";
+    } else {
+        for (std::size_t i = 0; i < hlls.size(); ++i) std::cerr << labels[i] << "," << hlls[i].count() << "," << hlls[i].size() << "\n";
+    }
     return 0;
 }
 
@@ -72,15 +577,20 @@ argparse::ArgumentParser get_parser_build()
     argparse::ArgumentParser parser("build");
     parser.add_description("Build HyperLogLog from FastX files");
     parser.add_argument("-k")
-        .help("k-mer size")
-        .scan<'u', std::size_t>()
+        .help("k-mer size, or list of sizes sketched in a single pass (e.g. 21,31,41 or 15:63:4), each in [1, 64] or [1, 32] with --hash packed. Multiple sizes write one <sketch>.k<k> file each")
         .required();
     parser.add_argument("-b")
         .help("header size (number of msb bits used as index)")
         .scan<'u', std::size_t>()
         .required();
+    parser.add_argument("--seeds")
+        .help("spaced seed patterns of length k (1 = care, 0 = don't care), one sketch per seed <sketch>.<seed>")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("--hash")
+        .help("k-mer hash backend, recorded in the sketch: nthash or packed (2-bit packed k-mers, k <= 32) [nthash]")
+        .default_value(std::string("nthash"));
     parser.add_argument("-g", "--ignore-short-reads")
-        .help("ignore reads shorter than k [active]")
+        .help("ignore reads shorter than the smallest k: not sketched, profiled, passed through nor counted as records. -g keeps them [active]")
         .default_value(true)
         .implicit_value(false);
     parser.add_argument("-e")
@@ -97,5 +607,92 @@ argparse::ArgumentParser get_parser_build()
     parser.add_argument("-s", "--sketch")
         .help("hll sketch, create or update with stream depending on if it exists or not")
         .default_value("");
+    parser.add_argument("--checkpoint-records")
+        .help("checkpoint the sketch and the input position every N records (0 = never). SIGUSR1 also triggers a checkpoint, and is reported and ignored when checkpoints are off")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--checkpoint-seconds")
+        .help("checkpoint the sketch and the input position every S seconds (0 = never)")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--resume")
+        .help("resume from the checkpoint of --sketch if present")
+        .default_value(false)
+        .implicit_value(true);
+    parser.add_argument("--min-qual")
+        .help("skip k-mers covering bases of quality < Q (FASTQ, Phred+33), as if they were N (0 = keep all)")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--min-abundance")
+        .help("only sketch k-mers seen at least t times, counted by a count-min sketch in front of each HLL (1 = all k-mers)")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(1));
+    parser.add_argument("--abundance-memory")
+        .help("memory of the --min-abundance counters, split among sketches, e.g. 512M or 4G. Larger means fewer k-mers admitted early [1G]")
+        .default_value(std::string("1G"));
+    parser.add_argument("--spectrum")
+        .help("also write the k-mer abundance spectrum to <sketch>.spectrum.tsv, estimated from exact counts of at most N hash-sampled k-mers (0 = off)")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--exclude")
+        .help("Bloom filter from the bloom command: k-mers found in it are not sketched (host depletion, novelty). Same k and hash required")
+        .default_value(std::string(""));
+    parser.add_argument("--window")
+        .help("also profile distinct k-mers in windows of this many bases along every record, written to --bedgraph [off]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--window-step")
+        .help("bases between window starts, divides --window (e.g. --window 10000 --window-step 1000) [window size]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--window-bits")
+        .help("header size of the window sketches, in [1, 16] [8]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(8));
+    parser.add_argument("--bedgraph")
+        .help("bedGraph of the window profile (record name, start, end, distinct k-mers)")
+        .default_value(std::string(""));
+    parser.add_argument("--sliding")
+        .help("also report distinct k-mers of the last N reads or seconds (see --sliding-unit) every --sliding-every units [off]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--sliding-unit")
+        .help("time unit of the sliding window: reads or seconds [reads]")
+        .default_value(std::string("reads"));
+    parser.add_argument("--sliding-every")
+        .help("units between two reports of the sliding window [window length]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--sliding-bits")
+        .help("header size of the sliding window sketch [12]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(12));
+    parser.add_argument("--sliding-report")
+        .help("TSV of time, records and estimate for the sliding window [stderr]")
+        .default_value(std::string(""));
+    parser.add_argument("--range-block")
+        .help("also sketch every block of this many records into --range-index, for queries on ranges of records with the range command [off]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--range-index")
+        .help("file of the block sketches and their pre-merged unions, written as blocks close")
+        .default_value(std::string(""));
+    parser.add_argument("--stream")
+        .help("hash records while reading them, in pieces of 4 MiB: memory stays bounded for records of any length. Not compatible with --passthrough and checkpoints")
+        .default_value(false)
+        .implicit_value(true);
+    parser.add_argument("-t", "--threads")
+        .help("hashing threads, long records are split across threads (0 = all cores). Every thread keeps a copy of the sketches [1]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(1));
+    parser.add_argument("--memory-budget")
+        .help("maximum memory for the registers of all sketches, e.g. 512M or 8G, checked before allocating [physical memory]")
+        .default_value(std::string(""));
+    parser.add_argument("--huge-pages")
+        .help("huge pages for sketches of b >= 21: off, thp (transparent) or hugetlb (reserved pages, falls back to thp) [thp]")
+        .default_value(std::string("thp"));
+    parser.add_argument("--numa")
+        .help("NUMA placement of large sketches: none, interleave or a node number [none]")
+        .default_value(std::string("none"));
     return parser;
 }
@@ -0,0 +1,32 @@
+#include "../include/compare.hpp"
+#include "../../lib/include/HyperLogLog.hpp"
+#include <filesystem>
+#include <iostream>
+
+int compare_main(const argparse::ArgumentParser& parser)
+{
+    using namespace sketching;
+    auto left_filename = parser.get<std::string>("left");
+    auto right_filename = parser.get<std::string>("right");
+    if (not std::filesystem::exists(left_filename)) throw std::runtime_error("sketch " + left_filename + " does not exist");
+    if (not std::filesystem::exists(right_filename)) throw std::runtime_error("sketch " + right_filename + " does not exist");
+    HyperLogLog left = HyperLogLog::load(left_filename);
+    HyperLogLog right = HyperLogLog::load(right_filename);
+    auto joint = left.joint_estimate(right);
+    std::cout << static_cast<std::size_t>(joint.intersection + 0.5) << "," 
+              << static_cast<std::size_t>(joint.only_left + 0.5) << "," 
+              << static_cast<std::size_t>(joint.only_right + 0.5) << "," 
+              << joint.jaccard() << "\n";
+    return 0;
+}
+
+argparse::ArgumentParser get_parser_compare()
+{
+    argparse::ArgumentParser parser("compare");
+    parser.add_description("Joint estimation of intersection and differences of two sketches (intersection,left-only,right-only,jaccard)");
+    parser.add_argument("left")
+        .help("first sketch");
+    parser.add_argument("right")
+        .help("second sketch");
+    return parser;
+}
@@ -0,0 +1,161 @@
+#include "../include/demux.hpp"
+#include "../../lib/include/HyperLogLog.hpp"
+#include "../../lib/include/BarcodeSketches.hpp"
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <unordered_set>
+#include <zlib.h>
+extern "C" {
+#include "../include/kseq.h"
+}
+
+KSEQ_INIT(gzFile, gzread)
+
+namespace {
+
+// field of the read name and comment split on any of the separators, negative fields count from the end. 
+// Scanned in place, nothing is allocated per read
+std::string_view name_field(std::string_view name, std::string_view separators, const int field)
+{
+    auto is_separator = [separators](const char c) { return separators.find(c) != std::string_view::npos; };
+    if (field >= 0) {
+        std::size_t start = 0;
+        int current = 0;
+        for (std::size_t i = 0; i <= name.size(); ++i) {
+            if (i < name.size() and not is_separator(name[i])) continue;
+            if (current++ == field) return name.substr(start, i - start);
+            start = i + 1;
+        }
+        return std::string_view();
+    }
+    std::size_t end = name.size();
+    int current = -1;
+    for (std::size_t i = name.size(); i > 0; --i) {
+        if (not is_separator(name[i - 1])) continue;
+        if (current-- == field) return name.substr(i, end - i);
+        end = i - 1;
+    }
+    return current == field ? name.substr(0, end) : std::string_view();
+}
+
+} // namespace
+
+int demux_main(const argparse::ArgumentParser& parser)
+{
+    using namespace sketching;
+    auto k = parser.get<std::size_t>("-k");
+    auto b = parser.get<std::size_t>("-b");
+    auto backend = hash_backend_from_string(parser.get<std::string>("--hash"));
+    auto input_filename = parser.get<std::string>("--input");
+    auto output_filename = parser.get<std::string>("--output");
+    auto whitelist_filename = parser.get<std::string>("--whitelist");
+    auto barcode_offset = parser.get<std::size_t>("--barcode-offset");
+    auto barcode_length = parser.get<std::size_t>("--barcode-length");
+    auto separators = parser.get<std::string>("--name-separators");
+    auto field = parser.get<int>("--name-field");
+    if (separators.empty()) throw std::invalid_argument("--name-separators cannot be empty");
+    if (k == 0 or k > 64) throw std::invalid_argument("k-mer size should be in [1, 64]");
+    if (b == 0 or b > 24) throw std::invalid_argument("number of indexing bits should be in [1, 24]");
+
+    std::unordered_set<std::string> whitelist;
+    if (whitelist_filename != "") {
+        std::ifstream wstrm(whitelist_filename);
+        if (not wstrm) throw std::runtime_error("unable to open whitelist " + whitelist_filename);
+        std::string buffer;
+        while (std::getline(wstrm, buffer)) {
+            if (not buffer.empty() and buffer.back() == '\r') buffer.pop_back();
+            if (not buffer.empty()) whitelist.insert(buffer);
+        }
+    }
+
+    gzFile fp = NULL;
+    if (input_filename == "") {
+        if ((fp = gzdopen(fileno(stdin), "r")) == NULL) return 1;
+    } else {
+        if ((fp = gzopen(input_filename.c_str(), "r")) == NULL) return 1;
+    }
+    BarcodeSketches sketches(static_cast<uint8_t>(k), static_cast<uint8_t>(b), backend);
+    kseq_t* seq = kseq_init(fp);
+    std::string name;
+    std::size_t unassigned = 0;
+    std::string lookup; // reused for whitelist queries
+    while (kseq_read(seq) >= 0) {
+        std::string_view barcode;
+        char const* sequence = seq->seq.s;
+        std::size_t length = seq->seq.l;
+        if (barcode_length) { // barcode bases are not sketched, nor anything before them
+            if (length >= barcode_offset + barcode_length) {
+                barcode = std::string_view(seq->seq.s + barcode_offset, barcode_length);
+                sequence += barcode_offset + barcode_length;
+                length -= barcode_offset + barcode_length;
+            }
+        } else {
+            name.assign(seq->name.s, seq->name.l);
+            if (seq->comment.l) name.append(" ").append(seq->comment.s, seq->comment.l);
+            barcode = name_field(name, separators, field);
+        }
+        if (not barcode.empty() and not whitelist.empty()) {
+            lookup.assign(barcode);
+            if (not whitelist.count(lookup)) barcode = std::string_view();
+        }
+        if (barcode.empty()) {
+            ++unassigned;
+            continue;
+        }
+        sketches.add(barcode, sequence, length);
+    }
+    kseq_destroy(seq);
+    gzclose(fp);
+
+    sketches.store(output_filename);
+    std::cout << "barcode\treads\testimate\ttotal\n";
+    for (std::size_t i = 0; i < sketches.size(); ++i) {
+        const auto hll = sketches.sketch(i);
+        std::cout << sketches.barcode(i) << "\t" << sketches.reads(i) << "\t" << hll.count() << "\t" << hll.size() << "\n";
+    }
+    std::cerr << "[demux] " << sketches.size() << " barcodes (" << sketches.dense() << " dense), " << unassigned << " unassigned reads\n";
+    return 0;
+}
+
+argparse::ArgumentParser get_parser_demux()
+{
+    argparse::ArgumentParser parser("demux");
+    parser.add_description("One sketch per cell or sample barcode in a single pass, all written to one file (prints a TSV of barcode, reads, estimate and total k-mers)");
+    parser.add_argument("-k")
+        .help("k-mer size")
+        .scan<'u', std::size_t>()
+        .required();
+    parser.add_argument("-b")
+        .help("header size (number of msb bits used as index), in [1, 24]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(12));
+    parser.add_argument("--hash")
+        .help("k-mer hash backend, recorded in the sketches: nthash or packed (2-bit packed k-mers, k <= 32) [nthash]")
+        .default_value(std::string("nthash"));
+    parser.add_argument("-i", "--input")
+        .help("input filename [stdin]")
+        .default_value(std::string(""));
+    parser.add_argument("-o", "--output")
+        .help("output file holding the sketches of all barcodes")
+        .required();
+    parser.add_argument("-w", "--whitelist")
+        .help("file of accepted barcodes (1 per row), reads with other barcodes are skipped")
+        .default_value(std::string(""));
+    parser.add_argument("--barcode-offset")
+        .help("start of the barcode in the read sequence, with --barcode-length")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--barcode-length")
+        .help("take the barcode from the read sequence instead of its name, only the bases after it are sketched")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--name-separators")
+        .help("characters splitting the read name and comment into fields [: ]")
+        .default_value(std::string(": "));
+    parser.add_argument("--name-field")
+        .help("field of the read name holding the barcode, negative values count from the end [-1]")
+        .scan<'i', int>()
+        .default_value(-1);
+    return parser;
+}
@@ -1,32 +1,145 @@
 #include "../include/estimate.hpp"
 #include "../../lib/include/HyperLogLog.hpp"
+#include "../../lib/include/BarcodeSketches.hpp"
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include <glob.h>
+
+namespace {
+
+struct estimate_row_t {
+    std::size_t estimate = 0;
+    std::size_t total = 0;
+    double standard_error = 0;
+    std::string error;
+};
+
+std::vector<std::string> expand_glob(std::string const& pattern)
+{
+    std::vector<std::string> matches;
+    glob_t buffer;
+    if (glob(pattern.c_str(), 0, NULL, &buffer) == 0) {
+        for (std::size_t i = 0; i < buffer.gl_pathc; ++i) matches.push_back(buffer.gl_pathv[i]);
+    }
+    globfree(&buffer);
+    return matches;
+}
+
+} // namespace
 
 int estimate_main(const argparse::ArgumentParser& parser)
 {
+    auto trim = [](std::string& s) {
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
+    };
     using namespace sketching;
     auto sketch_filename = parser.get<std::string>("--sketch");
     auto print_total_kmers = parser.get<bool>("--total");
-    HyperLogLog hll;
-    if (std::filesystem::exists(sketch_filename)) hll = HyperLogLog::load(sketch_filename);
-    else throw std::runtime_error("sketch does not exist");
-    std::cout << hll.count();
-    if (print_total_kmers) std::cout << "," << hll.size();
-    std::cout << "\n";
-    return 0;
+    auto sketches_filenames = parser.get<std::vector<std::string>>("sketches");
+    auto file_lists = parser.get<std::vector<std::string>>("--input-lists");
+    auto patterns = parser.get<std::vector<std::string>>("--glob");
+    auto nthreads = parser.get<std::size_t>("--threads");
+    auto demux_filename = parser.get<std::string>("--demux");
+
+    if (demux_filename != "") { // all barcodes of a demux file
+        if (not std::filesystem::exists(demux_filename)) throw std::runtime_error("demux file does not exist");
+        std::cout << "barcode\treads\testimate\ttotal\tstandard_error\n";
+        for (auto const& entry : BarcodeSketches::load(demux_filename)) {
+            std::cout << entry.barcode << "\t" << entry.reads << "\t" << entry.sketch.count() << "\t" << entry.sketch.size() << "\t" << entry.sketch.standard_error() << "\n";
+        }
+        return 0;
+    }
+
+    if (sketches_filenames.empty() and file_lists.empty() and patterns.empty()) { // single sketch
+        if (sketch_filename == "") throw std::runtime_error("no sketch given");
+        HyperLogLog hll;
+        if (std::filesystem::exists(sketch_filename)) hll = HyperLogLog::load(sketch_filename);
+        else throw std::runtime_error("sketch does not exist");
+        std::cout << hll.count();
+        if (print_total_kmers) std::cout << "," << hll.size();
+        std::cout << "\n";
+        return 0;
+    }
+
+    if (sketch_filename != "") sketches_filenames.insert(sketches_filenames.begin(), sketch_filename);
+    for (auto const& list_filename : file_lists) {
+        std::string buffer;
+        std::ifstream flist(list_filename);
+        while (std::getline(flist, buffer)) {
+            trim(buffer);
+            if (not buffer.empty()) sketches_filenames.push_back(buffer);
+        }
+    }
+    for (auto const& pattern : patterns) {
+        auto matches = expand_glob(pattern);
+        sketches_filenames.insert(sketches_filenames.end(), matches.begin(), matches.end());
+    }
+    if (nthreads == 0) nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+    nthreads = std::min(nthreads, std::max(sketches_filenames.size(), std::size_t(1)));
+
+    std::vector<estimate_row_t> rows(sketches_filenames.size());
+    std::atomic<std::size_t> next(0);
+    auto worker = [&]() {
+        for (std::size_t i = next++; i < sketches_filenames.size(); i = next++) {
+            try {
+                if (not std::filesystem::exists(sketches_filenames[i])) throw std::runtime_error("sketch does not exist");
+                const HyperLogLog hll = HyperLogLog::load(sketches_filenames[i]);
+                rows[i].estimate = hll.count();
+                rows[i].total = hll.size();
+                rows[i].standard_error = hll.standard_error();
+            } catch (const std::exception& e) {
+                rows[i].error = e.what();
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (std::size_t t = 0; t < nthreads; ++t) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+
+    int ret = 0;
+    std::cout << "path\testimate\ttotal\tstandard_error\n";
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        if (rows[i].error != "") {
+            std::cerr << "[estimate] " << sketches_filenames[i] << ": " << rows[i].error << "\n";
+            ret = 1;
+            continue;
+        }
+        std::cout << sketches_filenames[i] << "\t" << rows[i].estimate << "\t" << rows[i].total << "\t" << rows[i].standard_error << "\n";
+    }
+    return ret;
 }
 
 argparse::ArgumentParser get_parser_estimate()
 {
     argparse::ArgumentParser parser("estimate");
-    parser.add_description("Print sketch estimation");
+    parser.add_description("Print sketch estimation (TSV of path, estimate, total k-mers and standard error for multiple sketches)");
     parser.add_argument("-s", "--sketch")
         .help("hll sketch to query")
-        .required();
+        .default_value(std::string(""));
+    parser.add_argument("sketches")
+        .help("list of sketches to be estimated in batch")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-i", "--input-lists")
+        .help("file(s) listing sketches to be estimated (1 sketch filename per row)")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-g", "--glob")
+        .help("glob pattern(s) of sketches to be estimated")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-d", "--demux")
+        .help("file written by demux, estimates every barcode (TSV of barcode, reads, estimate, total k-mers and standard error)")
+        .default_value(std::string(""));
+    parser.add_argument("-j", "--threads")
+        .help("number of threads for batch estimation [all cores]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
     parser.add_argument("-t", "--total")
         .help("also print total k-mers seen (L1 norm)")
         .default_value(false)
         .implicit_value(true);
     return parser;
-}
\ No newline at end of file
+}
@@ -2,16 +2,39 @@
 #include "../include/build.hpp"
 #include "../include/estimate.hpp"
 #include "../include/merge.hpp"
+#include "../include/compare.hpp"
+#include "../include/query.hpp"
+#include "../include/bloom.hpp"
+#include "../include/demux.hpp"
+#include "../include/records.hpp"
+#include "../include/range.hpp"
+#include "../../lib/include/Kernels.hpp"
 
 int main(int argc, char* argv[])
 {
     auto build_parser = get_parser_build();
     auto estimate_parser = get_parser_estimate();
     auto merge_parser = get_parser_merge();
+    auto compare_parser = get_parser_compare();
+    auto query_parser = get_parser_query();
+    auto bloom_parser = get_parser_bloom();
+    auto demux_parser = get_parser_demux();
+    auto records_parser = get_parser_records();
+    auto range_parser = get_parser_range();
     argparse::ArgumentParser program(argv[0]);
     program.add_subparser(build_parser);
     program.add_subparser(estimate_parser);
     program.add_subparser(merge_parser);
+    program.add_subparser(compare_parser);
+    program.add_subparser(query_parser);
+    program.add_subparser(bloom_parser);
+    program.add_subparser(demux_parser);
+    program.add_subparser(records_parser);
+    program.add_subparser(range_parser);
+    program.add_argument("--cpu-dispatch")
+        .help("print the code path selected for each kernel on this CPU")
+        .default_value(false)
+        .implicit_value(true);
     try {
         program.parse_args(argc, argv);
     } catch (const std::runtime_error& e) {
@@ -19,10 +42,17 @@ int main(int argc, char* argv[])
         std::cerr << program;
         return 1;
     }
+    if (program.get<bool>("--cpu-dispatch")) std::cerr << sketching::cpu::dispatch_report();
     if (program.is_subcommand_used(build_parser)) return build_main(build_parser);
     else if (program.is_subcommand_used(estimate_parser)) return estimate_main(estimate_parser);
     else if (program.is_subcommand_used(merge_parser)) return merge_main(merge_parser);
-    else std::cerr << program << std::endl;
+    else if (program.is_subcommand_used(compare_parser)) return compare_main(compare_parser);
+    else if (program.is_subcommand_used(query_parser)) return query_main(query_parser);
+    else if (program.is_subcommand_used(bloom_parser)) return bloom_main(bloom_parser);
+    else if (program.is_subcommand_used(demux_parser)) return demux_main(demux_parser);
+    else if (program.is_subcommand_used(records_parser)) return records_main(records_parser);
+    else if (program.is_subcommand_used(range_parser)) return range_main(range_parser);
+    else if (not program.get<bool>("--cpu-dispatch")) std::cerr << program << std::endl;
     return 0;
 }
 
@@ -2,6 +2,7 @@
 #include "../../lib/include/HyperLogLog.hpp"
 #include <filesystem>
 #include <fstream>
+#include <limits>
 
 int merge_main(const argparse::ArgumentParser& parser) 
 {
@@ -13,6 +14,7 @@ int merge_main(const argparse::ArgumentParser& parser)
     auto file_lists = parser.get<std::vector<std::string>>("--input-lists");
     auto sketches_filenames = parser.get<std::vector<std::string>>("sketches");
     auto output_filename = parser.get<std::string>("--output-sketch");
+    auto fold_b = parser.get<std::size_t>("-b");
 
     for (auto const& list_filename : file_lists) {
         std::string buffer;
@@ -22,6 +24,11 @@ int merge_main(const argparse::ArgumentParser& parser)
             sketches_filenames.push_back(buffer);
         }
     }
+    if (fold_b != 0) { // the merged sketch has the smallest header size, checked before loading any register
+        std::size_t merged_b = sketches_filenames.empty() ? 0 : std::numeric_limits<std::size_t>::max();
+        for (auto const& sketch_filename : sketches_filenames) merged_b = std::min<std::size_t>(merged_b, HyperLogLog::load_msb_length(sketch_filename));
+        if (fold_b > merged_b) throw std::invalid_argument("-b " + std::to_string(fold_b) + " is larger than the header size of the merged sketch (" + std::to_string(merged_b) + ")");
+    }
 
     HyperLogLog hll;
     if (not sketches_filenames.empty()) {
@@ -33,6 +40,7 @@ int merge_main(const argparse::ArgumentParser& parser)
         }
     }
 
+    if (fold_b != 0) hll = hll.fold(static_cast<uint8_t>(fold_b));
     if (output_filename != "") hll.store(output_filename);
     std::cerr << hll.count() << "," << hll.size() << "\n";
 
@@ -52,5 +60,9 @@ argparse::ArgumentParser get_parser_merge()
     parser.add_argument("-o", "--output-sketch")
         .help("output sketch (optional)")
         .default_value("");
+    parser.add_argument("-b")
+        .help("fold the merged sketch down to this header size (optional, sketches of different sizes are folded to the smallest one anyway)")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
     return parser;
 }
@@ -0,0 +1,133 @@
+#include "../include/query.hpp"
+#include "../../lib/include/HyperLogLog.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+int query_main(const argparse::ArgumentParser& parser)
+{
+    auto trim = [](std::string& s) {
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
+        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
+    };
+    using namespace sketching;
+    using hit_t = std::pair<double, std::size_t>; // (score, reference index)
+    auto query_filename = parser.get<std::string>("--query");
+    auto file_lists = parser.get<std::vector<std::string>>("--input-lists");
+    auto references = parser.get<std::vector<std::string>>("references");
+    auto top = parser.get<std::size_t>("--top");
+    auto metric = parser.get<std::string>("--metric");
+    auto nthreads = parser.get<std::size_t>("--threads");
+    auto prefilter_bits = parser.get<std::size_t>("--prefilter");
+
+    if (metric != "jaccard" and metric != "containment") throw std::invalid_argument("metric should be either jaccard or containment");
+    if (top == 0) throw std::invalid_argument("--top should be > 0");
+    if (nthreads == 0) nthreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (auto const& list_filename : file_lists) {
+        std::string buffer;
+        std::ifstream flist(list_filename);
+        while (std::getline(flist, buffer)) {
+            trim(buffer);
+            if (not buffer.empty()) references.push_back(buffer);
+        }
+    }
+    std::vector<std::string> sketches_filenames;
+    for (auto const& ref : references) {
+        if (std::filesystem::is_directory(ref)) {
+            for (auto const& entry : std::filesystem::directory_iterator(ref)) {
+                if (entry.is_regular_file()) sketches_filenames.push_back(entry.path().string());
+            }
+        } else {
+            sketches_filenames.push_back(ref);
+        }
+    }
+
+    if (not std::filesystem::exists(query_filename)) throw std::runtime_error("query sketch does not exist");
+    const HyperLogLog query = HyperLogLog::load(query_filename);
+    if (prefilter_bits >= query.msb_length()) { // a prefilter only helps on fewer registers than the query has
+        throw std::invalid_argument("--prefilter should be smaller than the header size of the query sketch (" + std::to_string(query.msb_length()) + ")");
+    }
+    const std::size_t prefilter_registers = prefilter_bits ? (std::size_t(1) << prefilter_bits) : 0;
+    // heuristic, not a bound: Jaccard and containment move by ~2 relative union errors, 3 sigmas of the sampled estimate.
+    // A true top-k reference can still fall below it, so --prefilter is approximate and off by default
+    const double prefilter_margin = prefilter_bits ? 6 * 1.04 / std::sqrt(static_cast<double>(prefilter_registers)) : 0;
+    auto score = [&metric](JointEstimate const& est) { return metric == "jaccard" ? est.jaccard() : est.containment(); };
+
+    std::atomic<std::size_t> next(0);
+    std::mutex log_mutex;
+    std::vector<std::vector<hit_t>> partial(nthreads);
+    auto worker = [&](std::size_t tid) {
+        std::priority_queue<hit_t, std::vector<hit_t>, std::greater<hit_t>> best; // min-heap of the current top-k
+        for (std::size_t i = next++; i < sketches_filenames.size(); i = next++) {
+            try {
+                if (not std::filesystem::exists(sketches_filenames[i])) throw std::runtime_error("sketch does not exist");
+                const HyperLogLog ref = HyperLogLog::load(sketches_filenames[i]);
+                if (prefilter_registers and best.size() == top) {
+                    auto coarse = score(query.inclusion_exclusion(ref, prefilter_registers));
+                    if (coarse + prefilter_margin < best.top().first) continue;
+                }
+                const double s = score(query.inclusion_exclusion(ref));
+                if (best.size() < top) best.emplace(s, i);
+                else if (s > best.top().first) {
+                    best.pop();
+                    best.emplace(s, i);
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cerr << "[query] skipping " << sketches_filenames[i] << ": " << e.what() << "\n";
+            }
+        }
+        while (not best.empty()) {
+            partial[tid].push_back(best.top());
+            best.pop();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (std::size_t t = 0; t < nthreads; ++t) pool.emplace_back(worker, t);
+    for (auto& t : pool) t.join();
+
+    std::vector<hit_t> hits;
+    for (auto const& p : partial) hits.insert(hits.end(), p.begin(), p.end());
+    std::sort(hits.begin(), hits.end(), [](hit_t const& a, hit_t const& b) { return a.first > b.first; });
+    if (hits.size() > top) hits.resize(top);
+    for (auto const& [s, i] : hits) std::cout << sketches_filenames[i] << "," << s << "\n";
+    return 0;
+}
+
+argparse::ArgumentParser get_parser_query()
+{
+    argparse::ArgumentParser parser("query");
+    parser.add_description("Find the top-k reference sketches closest to a query sketch");
+    parser.add_argument("-q", "--query")
+        .help("query sketch")
+        .required();
+    parser.add_argument("references")
+        .help("reference sketches or directories of sketches")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-i", "--input-lists")
+        .help("file(s) listing reference sketches (1 sketch filename per row)")
+        .nargs(argparse::nargs_pattern::any);
+    parser.add_argument("-n", "--top")
+        .help("number of references to report")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(10));
+    parser.add_argument("-m", "--metric")
+        .help("ranking metric: jaccard or containment (of the query in the reference)")
+        .default_value(std::string("jaccard"));
+    parser.add_argument("-t", "--threads")
+        .help("number of threads [all cores]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("-f", "--prefilter")
+        .help("approximate: skip references whose score on the first 2^f registers is far below the current top-k. May drop a true top-k reference. Smaller than the query header size (0 = exact) [0]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    return parser;
+}
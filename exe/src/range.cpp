@@ -0,0 +1,41 @@
+#include "../include/range.hpp"
+#include "../../lib/include/HyperLogLog.hpp"
+#include "../../lib/include/RangeSketches.hpp"
+#include <filesystem>
+#include <iostream>
+#include <limits>
+
+int range_main(const argparse::ArgumentParser& parser)
+{
+    using namespace sketching;
+    auto index_filename = parser.get<std::string>("index");
+    auto first = parser.get<std::size_t>("--from");
+    auto last = parser.get<std::size_t>("--to");
+    auto output_filename = parser.get<std::string>("--output-sketch");
+    if (not std::filesystem::exists(index_filename)) throw std::runtime_error("range sketch file " + index_filename + " does not exist");
+    auto range = RangeSketches::query(index_filename, first, last);
+    if (output_filename != "") range.sketch.store(output_filename);
+    std::cout << "first\tlast\testimate\ttotal\n";
+    std::cout << range.first << "\t" << range.last << "\t" << range.sketch.count() << "\t" << range.sketch.size() << "\n";
+    return 0;
+}
+
+argparse::ArgumentParser get_parser_range()
+{
+    argparse::ArgumentParser parser("range");
+    parser.add_description("Distinct k-mers of a range of input records, from the file of build --range-index (TSV of first record, record after the range, estimate and total k-mers)");
+    parser.add_argument("index")
+        .help("range sketch file");
+    parser.add_argument("--from")
+        .help("first record of the range, 0-based. Widened to the start of its block [0]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(0));
+    parser.add_argument("--to")
+        .help("record after the range. Widened to the end of its block [end of input]")
+        .scan<'u', std::size_t>()
+        .default_value(std::numeric_limits<std::size_t>::max());
+    parser.add_argument("-o", "--output-sketch")
+        .help("also store the sketch of the range")
+        .default_value(std::string(""));
+    return parser;
+}
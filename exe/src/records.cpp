@@ -0,0 +1,60 @@
+#include "../include/records.hpp"
+#include "../../lib/include/HyperLogLog.hpp"
+#include "../../lib/include/RecordSketch.hpp"
+#include <iostream>
+#include <zlib.h>
+extern "C" {
+#include "../include/kseq.h"
+}
+
+KSEQ_INIT(gzFile, gzread)
+
+int records_main(const argparse::ArgumentParser& parser)
+{
+    using namespace sketching;
+    auto k = parser.get<std::size_t>("-k");
+    auto b = parser.get<std::size_t>("-b");
+    auto backend = hash_backend_from_string(parser.get<std::string>("--hash"));
+    auto input_filename = parser.get<std::string>("--input");
+    if (k == 0 or k > 64) throw std::invalid_argument("k-mer size should be in [1, 64]");
+    if (b == 0 or b > 32) throw std::invalid_argument("number of indexing bits should be in [1, 32]");
+
+    gzFile fp = NULL;
+    if (input_filename == "") {
+        if ((fp = gzdopen(fileno(stdin), "r")) == NULL) return 1;
+    } else {
+        if ((fp = gzopen(input_filename.c_str(), "r")) == NULL) return 1;
+    }
+    RecordSketch sketch(static_cast<uint8_t>(k), static_cast<uint8_t>(b), backend); // one sketch for all records
+    kseq_t* seq = kseq_init(fp);
+    std::cout << "name\tlength\testimate\n";
+    while (kseq_read(seq) >= 0) {
+        sketch.add(seq->seq.s, seq->seq.l);
+        std::cout.write(seq->name.s, seq->name.l) << "\t" << seq->seq.l << "\t" << sketch.count() << "\n";
+        sketch.clear();
+    }
+    kseq_destroy(seq);
+    gzclose(fp);
+    return 0;
+}
+
+argparse::ArgumentParser get_parser_records()
+{
+    argparse::ArgumentParser parser("records");
+    parser.add_description("Distinct k-mers of every read or contig (TSV of name, length and estimate)");
+    parser.add_argument("-k")
+        .help("k-mer size")
+        .scan<'u', std::size_t>()
+        .required();
+    parser.add_argument("-b")
+        .help("header size (number of msb bits used as index), in [1, 32]. Only the registers a record touches are reset [12]")
+        .scan<'u', std::size_t>()
+        .default_value(std::size_t(12));
+    parser.add_argument("--hash")
+        .help("k-mer hash backend: nthash or packed (2-bit packed k-mers, k <= 32) [nthash]")
+        .default_value(std::string("nthash"));
+    parser.add_argument("-i", "--input")
+        .help("input filename [stdin]")
+        .default_value(std::string(""));
+    return parser;
+}
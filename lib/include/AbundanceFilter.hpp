@@ -0,0 +1,61 @@
+#ifndef ABUNDANCE_FILTER_HPP
+#define ABUNDANCE_FILTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "RegisterMemory.hpp"
+
+namespace sketching {
+
+/**
+ * Count-min sketch with conservative update and counters saturating at the threshold. 
+ * admit() counts one occurrence of a k-mer hash and tells whether the k-mer has now been 
+ * seen at least min_abundance times. Collisions only overestimate, so a k-mer is never 
+ * admitted late but may be admitted early. Counters live in register memory (lazy zero 
+ * pages, counted in the memory budget). Concurrent filters update counters atomically, 
+ * so several threads can share one.
+ */
+class AbundanceFilter
+{
+    public:
+        static constexpr std::size_t rows = 4;
+
+        AbundanceFilter(const std::size_t bytes, const uint8_t min_abundance, const bool concurrent);
+
+        bool admit(const uint64_t h0, const uint64_t h1) noexcept
+        {
+            std::size_t idx[rows];
+            uint8_t smallest = 0xFF;
+            for (std::size_t i = 0; i < rows; ++i) { // Kirsch-Mitzenmacher double hashing
+                idx[i] = i * width + ((h0 + i * h1) & width_mask);
+                const uint8_t c = concurrent ? __atomic_load_n(&counters[idx[i]], __ATOMIC_RELAXED) : counters[idx[i]];
+                if (c < smallest) smallest = c;
+            }
+            if (smallest >= threshold) return true;
+            for (std::size_t i = 0; i < rows; ++i) { // conservative update, only the smallest counters grow
+                auto& c = counters[idx[i]];
+                if (concurrent) {
+                    uint8_t expected = smallest;
+                    __atomic_compare_exchange_n(&c, &expected, smallest + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+                } else if (c == smallest) {
+                    c = smallest + 1;
+                }
+            }
+            return smallest + 1 >= threshold;
+        }
+
+        uint8_t min_abundance() const noexcept { return threshold; }
+        std::size_t bytes() const noexcept { return counters.size(); }
+
+    private:
+        std::size_t width; // counters per row, power of 2
+        std::size_t width_mask;
+        uint8_t threshold;
+        bool concurrent;
+        std::vector<uint8_t, memory::RegisterAllocator<uint8_t>> counters;
+};
+
+} // namespace sketching
+
+#endif // ABUNDANCE_FILTER_HPP
@@ -0,0 +1,78 @@
+#ifndef BARCODE_SKETCHES_HPP
+#define BARCODE_SKETCHES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "HyperLogLog.hpp"
+#include "KmerHasher.hpp"
+#include "RegisterMemory.hpp"
+
+namespace sketching {
+
+struct barcode_sketch_t {
+    std::string barcode;
+    std::size_t reads;
+    HyperLogLog sketch;
+};
+
+/**
+ * One HLL sketch per barcode, filled in a single pass over demultiplexed reads. 
+ * A barcode starts sparse, as a list of (register, rank) entries that is sorted and 
+ * deduplicated as it grows, and is promoted to dense registers once the list would 
+ * outweigh them. Dense registers are carved out of shared blocks of register memory. 
+ * Every sketch is identical to the one build would make from the same reads. Not thread safe.
+ */
+class BarcodeSketches
+{
+    public:
+        BarcodeSketches(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend);
+        BarcodeSketches(BarcodeSketches const&) = delete;
+        BarcodeSketches& operator=(BarcodeSketches const&) = delete;
+
+        void add(std::string_view barcode, char const * const seq, const std::size_t length);
+
+        std::size_t size() const noexcept; // number of barcodes
+        std::size_t dense() const noexcept; // barcodes promoted to dense registers
+        std::string const& barcode(const std::size_t i) const noexcept;
+        std::size_t reads(const std::size_t i) const noexcept;
+        HyperLogLog sketch(const std::size_t i) const;
+
+        // all sketches in one file: magic, number of barcodes, then (name, reads, sketch) each
+        void store(std::string const& filename) const;
+        static std::vector<barcode_sketch_t> load(std::string const& filename);
+
+    private:
+        static constexpr uint32_t no_registers = ~uint32_t(0);
+        static constexpr std::size_t block_bytes = std::size_t(1) << 21;
+
+        struct entry_t {
+            std::string name;
+            std::size_t reads = 0;
+            std::size_t total = 0;
+            std::vector<uint32_t> sparse; // register << 8 | rank
+            std::size_t compacted = 0; // sorted and deduplicated prefix of sparse
+            uint32_t registers = no_registers; // dense slot
+        };
+
+        uint8_t b;
+        std::size_t m;
+        std::size_t per_block;
+        KmerHasher hasher;
+        std::unordered_map<std::string, uint32_t> index;
+        std::vector<entry_t> entries;
+        std::vector<std::vector<uint8_t, memory::RegisterAllocator<uint8_t>>> blocks;
+        std::size_t nslots;
+
+        uint8_t* registers_of(entry_t const& entry) const noexcept;
+        void insert(entry_t& entry, const RegisterRank update);
+        void compact(entry_t& entry);
+        void promote(entry_t& entry);
+};
+
+} // namespace sketching
+
+#endif // BARCODE_SKETCHES_HPP
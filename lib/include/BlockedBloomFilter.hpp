@@ -0,0 +1,85 @@
+#ifndef BLOCKED_BLOOM_FILTER_HPP
+#define BLOCKED_BLOOM_FILTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "HyperLogLog.hpp"
+
+namespace sketching {
+
+/**
+ * Bloom filter of k-mer hashes split in 64-byte (cache line) blocks: the first hash word 
+ * picks the block, the second one gives up to 7 probes of 9 bits inside it, so a lookup 
+ * touches a single cache line. Built in anonymous memory and stored to a file that 
+ * load() maps read-only, sharing pages between processes.
+ */
+class BlockedBloomFilter
+{
+    public:
+        static constexpr std::size_t block_bytes = 64;
+
+        BlockedBloomFilter(const std::size_t bytes, const uint8_t kmer_length, const HashBackend hash_backend, const uint8_t probes);
+        ~BlockedBloomFilter();
+        BlockedBloomFilter(BlockedBloomFilter const&) = delete;
+        BlockedBloomFilter& operator=(BlockedBloomFilter const&) = delete;
+        BlockedBloomFilter(BlockedBloomFilter&& other) noexcept;
+
+        void insert(const uint64_t h0, const uint64_t h1) noexcept
+        {
+            uint64_t* block = blocks + 8 * block_index(h0);
+            for (unsigned i = 0; i < nprobes; ++i) {
+                const unsigned bit = (h1 >> (9 * i)) & 511;
+                block[bit >> 6] |= uint64_t(1) << (bit & 63);
+            }
+        }
+
+        bool contains(const uint64_t h0, const uint64_t h1) const noexcept
+        {
+            uint64_t const* block = blocks + 8 * block_index(h0);
+            for (unsigned i = 0; i < nprobes; ++i) {
+                const unsigned bit = (h1 >> (9 * i)) & 511;
+                if (not (block[bit >> 6] & (uint64_t(1) << (bit & 63)))) return false;
+            }
+            return true;
+        }
+
+        uint8_t kmer_length() const noexcept { return k; }
+        HashBackend hash_backend() const noexcept { return backend; }
+        uint8_t probes() const noexcept { return nprobes; }
+        std::size_t bytes() const noexcept { return nblocks * block_bytes; }
+        double false_positive_rate(const std::size_t distinct_kmers) const noexcept;
+
+        void store(std::string const& filename) const;
+        static BlockedBloomFilter load(std::string const& filename);
+
+    private:
+        BlockedBloomFilter() noexcept;
+        uint8_t k;
+        HashBackend backend;
+        uint8_t nprobes;
+        uint64_t nblocks;
+        uint64_t* blocks;
+        void* mapping; // whole file when loaded, nullptr for anonymous memory
+        std::size_t mapping_length;
+
+        std::size_t block_index(const uint64_t h0) const noexcept
+        {
+            return static_cast<std::size_t>((static_cast<__uint128_t>(h0) * nblocks) >> 64);
+        }
+};
+
+// keeps the k-mers absent from the filter
+class ExclusionFilter : public KmerFilter
+{
+    public:
+        explicit ExclusionFilter(std::shared_ptr<BlockedBloomFilter const> filter) noexcept : filter(std::move(filter)) {}
+        bool keep(const uint64_t h0, const uint64_t h1) noexcept override { return not filter->contains(h0, h1); }
+
+    private:
+        std::shared_ptr<BlockedBloomFilter const> filter;
+};
+
+} // namespace sketching
+
+#endif // BLOCKED_BLOOM_FILTER_HPP
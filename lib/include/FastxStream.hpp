@@ -0,0 +1,69 @@
+#ifndef FASTX_STREAM_HPP
+#define FASTX_STREAM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <zlib.h>
+
+namespace sketching {
+
+/**
+ * FASTA/FASTQ sequences in pieces of at most chunk_size bases, parsed by a background 
+ * thread so reading overlaps hashing. A record longer than chunk_size is cut into several 
+ * pieces, each starting with the last overlap bases of the previous one (carry), so a k-mer 
+ * with k <= overlap + 1 lies entirely in at least one piece. Memory is bounded by about 
+ * (max_queued + 2) * chunk_size regardless of record length.
+ */
+class FastxStream
+{
+    public:
+        struct piece_t {
+            std::string data;
+            std::size_t carry = 0; // leading bases repeated from the previous piece of the record
+            bool first = false; // piece starts a record
+            bool last = false; // piece ends a record
+        };
+
+        FastxStream(gzFile fp, const std::size_t chunk_size, const std::size_t overlap, const std::size_t max_queued = 4);
+        ~FastxStream();
+        FastxStream(FastxStream const&) = delete;
+        FastxStream& operator=(FastxStream const&) = delete;
+
+        // blocks until the next piece is parsed, false at end of input
+        bool next(piece_t& piece);
+
+    private:
+        gzFile fp;
+        std::size_t chunk_size;
+        std::size_t overlap;
+        std::size_t max_queued;
+        std::string input; // raw bytes from gzread
+        std::size_t begin;
+        bool eof;
+        piece_t current;
+        bool done;
+        std::atomic<bool> stopping;
+        std::deque<piece_t> queue;
+        std::mutex mutex;
+        std::condition_variable produced;
+        std::condition_variable consumed;
+        std::thread reader;
+
+        void parse();
+        bool fill();
+        int peek();
+        void skip_line();
+        std::size_t append_line();
+        std::size_t skip_qualities(std::size_t length);
+        void emit(const bool last);
+        void push(piece_t&& piece);
+};
+
+} // namespace sketching
+
+#endif // FASTX_STREAM_HPP
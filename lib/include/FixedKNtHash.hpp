@@ -0,0 +1,112 @@
+#ifndef FIXED_K_NTHASH_HPP
+#define FIXED_K_NTHASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include "../nthash/internal.hpp"
+
+namespace sketching {
+
+/**
+ * Split-rotation srol applied K times (nthash::srol_table(c, K) on any word), 
+ * the 31 and 33 bit halves rotate independently so both amounts fold to constants.
+ */
+template <unsigned K>
+inline uint64_t srol_k(const uint64_t x) noexcept
+{
+    constexpr unsigned hi_rot = K % 31;
+    constexpr unsigned lo_rot = K % 33;
+    constexpr uint64_t hi_mask = 0x7FFFFFFFULL;
+    constexpr uint64_t lo_mask = 0x1FFFFFFFFULL;
+    uint64_t hi = x >> 33;
+    uint64_t lo = x & lo_mask;
+    hi = ((hi << hi_rot) | (hi >> ((31 - hi_rot) % 31))) & hi_mask;
+    lo = ((lo << lo_rot) | (lo >> ((33 - lo_rot) % 33))) & lo_mask;
+    return (hi << 33) | lo;
+}
+
+/**
+ * nthash::NtHash with 2 hashes per k-mer over a run holding only nucleotides (see for_each_valid_run), 
+ * so no base is checked. K > 0 fixes k at compile time, K == 0 reads it from k. 
+ * Same roll()/hashes() protocol and same hash values, runs shorter than k produce no hash.
+ */
+template <uint16_t K>
+class FixedKNtHash
+{
+    public:
+        FixedKNtHash(char const * const run, const std::size_t run_len, const std::size_t k = K) noexcept
+            : seq(run), seq_len(run_len), k(K ? K : k), pos(0), initialized(false), fwd(0), rev(0), multiplier(1 ^ (K ? K : k) * nthash::MULTISEED)
+        {}
+
+        bool roll() noexcept
+        {
+            if (not initialized) return init();
+            if (pos + span() >= seq_len) return false;
+            const auto char_in = static_cast<unsigned char>(seq[pos + span()]);
+            const auto char_out = static_cast<unsigned char>(seq[pos]);
+            fwd = nthash::srol(fwd) ^ nthash::SEED_TAB[char_in] ^ rotate_k(char_out);
+            rev = nthash::sror(rev ^ rotate_k(char_in & nthash::CP_OFF) ^ nthash::SEED_TAB[char_out & nthash::CP_OFF]);
+            ++pos;
+            extend();
+            return true;
+        }
+
+        uint64_t const* hashes() const noexcept { return hash_arr; }
+
+    private:
+        char const * seq;
+        std::size_t seq_len;
+        std::size_t k;
+        std::size_t pos;
+        bool initialized;
+        uint64_t fwd;
+        uint64_t rev;
+        uint64_t multiplier;
+        uint64_t hash_arr[2];
+
+        std::size_t span() const noexcept
+        {
+            if constexpr (K > 0) return K;
+            else return k;
+        }
+
+        // the base hash rotated k times
+        uint64_t rotate_k(const unsigned char c) const noexcept
+        {
+            if constexpr (K > 0) return srol_k<K>(nthash::SEED_TAB[c]);
+            else return nthash::srol_table(c, k);
+        }
+
+        // first window, hashed base by base
+        bool init() noexcept
+        {
+            if (seq_len < span()) return false;
+            for (std::size_t i = 0; i < span(); ++i) {
+                const auto c = static_cast<unsigned char>(seq[i]);
+                fwd = nthash::srol(fwd) ^ nthash::SEED_TAB[c];
+                rev = nthash::sror(rev ^ rotate_k(c & nthash::CP_OFF));
+            }
+            initialized = true;
+            extend();
+            return true;
+        }
+
+        void extend() noexcept
+        {
+            hash_arr[0] = nthash::canonical(fwd, rev);
+            uint64_t t_val = hash_arr[0] * multiplier;
+            hash_arr[1] = t_val ^ (t_val >> nthash::MULTISHIFT);
+        }
+};
+
+// emit(hashes) for every k-mer of a valid run
+template <uint16_t K, typename Emit>
+inline void hash_valid_run(char const * const run, const std::size_t length, const std::size_t k, Emit&& emit)
+{
+    FixedKNtHash<K> hasher(run, length, k);
+    while (hasher.roll()) emit(hasher.hashes());
+}
+
+} // namespace sketching
+
+#endif // FIXED_K_NTHASH_HPP
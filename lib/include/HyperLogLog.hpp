@@ -1,12 +1,53 @@
 #ifndef HYPERLOGLOG_HPP
 #define HYPERLOGLOG_HPP
 
+#include <cmath>
 #include <cstdint>
 #include <vector>
+#include <string>
+#include <string_view>
 #include <fstream>
+#include <memory>
+#include "RegisterMemory.hpp"
 
 namespace sketching {
 
+enum class HashBackend : uint8_t
+{
+    nthash = 0, // canonical ntHash, any k
+    packed = 1 // 2-bit packed canonical k-mer + invertible mixers, k <= 32
+};
+
+HashBackend hash_backend_from_string(std::string const& name);
+std::string to_string(const HashBackend backend);
+
+struct JointEstimate
+{
+    double intersection; // |A & B|
+    double only_left; // |A \ B|
+    double only_right; // |B \ A|
+    double jaccard() const noexcept;
+    double containment() const noexcept; // fraction of A also in B
+};
+
+// register of a k-mer hash and the rank it sets there
+struct RegisterRank
+{
+    std::size_t index;
+    uint8_t rank;
+};
+
+class AbundanceFilter;
+class SpectrumSketch;
+
+// decides which k-mer hashes (two 64-bit words) go on to the spectrum and the registers
+class KmerFilter
+{
+    public:
+        virtual ~KmerFilter() = default;
+        virtual bool keep(const uint64_t h0, const uint64_t h1) noexcept = 0;
+};
+
 class HyperLogLog
 {
     private:
@@ -16,41 +57,104 @@ class HyperLogLog
         
     public:
         HyperLogLog();
-        HyperLogLog(const uint8_t kmer_length, const uint8_t msb_length);
-        HyperLogLog(const uint8_t kmer_length, const double error_rate);
+        HyperLogLog(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend = HashBackend::nthash);
+        HyperLogLog(const uint8_t kmer_length, const double error_rate, const HashBackend hash_backend = HashBackend::nthash);
         HyperLogLog(std::istream& istrm);
+        HyperLogLog(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend, uint8_t const * const registers, const std::size_t total_kmers); // copies 2^b registers
         void add(char const * const seq, const std::size_t length) noexcept;
-        void clear() noexcept;
+        void add(std::vector<std::string_view> const& batch);
+        static void add(std::vector<HyperLogLog>& sketches, std::vector<std::string> const& seeds, char const * const seq, const std::size_t length);
+        void clear() noexcept; // registers only, the total k-mers seen is kept
+        void reset() noexcept; // registers and total k-mers, as freshly built
+        void set_abundance_filter(std::shared_ptr<AbundanceFilter> filter) noexcept; // shared by copies, not stored
+        void set_spectrum(std::shared_ptr<SpectrumSketch> spectrum) noexcept; // fed every k-mer hash, shared by copies
+        void set_kmer_filter(std::shared_ptr<KmerFilter> filter) noexcept; // applied first, shared by copies
         std::size_t size() const noexcept;
+        HashBackend hash_backend() const noexcept;
+        uint8_t msb_length() const noexcept;
         std::size_t count() const noexcept;
         double standard_error() const noexcept;
+        JointEstimate joint_estimate(const HyperLogLog& other) const;
+        JointEstimate inclusion_exclusion(const HyperLogLog& other, std::size_t nregisters = 0) const;
+        HyperLogLog fold(const uint8_t msb_length) const;
         HyperLogLog operator+(const HyperLogLog& other) const;
         HyperLogLog& operator+=(const HyperLogLog& other);
         void store(std::ostream& ostrm) const;
         void store(std::string const& sketch_file) const;
         static HyperLogLog load(std::string const& sketch_filename);
+        static uint8_t load_msb_length(std::string const& sketch_filename); // header only, the registers are not read
+        static RegisterRank register_and_rank(const uint64_t h0, const uint64_t h1, const uint8_t msb_length) noexcept; // as add() with 2^b registers
+        static void sanitize_b(const std::size_t bval); // throws unless 1 <= b < 56
+        template <typename CountZeros>
+        static std::size_t estimate(const double inverse_power_sum, const std::size_t nregisters, CountZeros&& count_zeros) noexcept; // as count(), zeros are only counted for small ranges
 
     private:
         friend HyperLogLog load_hll(std::istream& istrm);
         void init();
+        void update(const hash_t hval) noexcept;
         void sanitize_endianness() const;
         void sanitize_kmer_length(const std::size_t kmer_length) const;
-        void sanitize_b(const std::size_t bval) const;
+        void sanitize_backend() const;
         bool compatible(const HyperLogLog& other) const noexcept;
-        double harmonic_mean() const noexcept;
-        double bias_correction(const double raw_estimate) const noexcept;
-        int clz(const uint32_t x) const noexcept;
-        int clz(const uint64_t x) const noexcept;
-        int clz(const __uint128_t x) const noexcept;
+        static double histogram_estimate(std::vector<std::size_t> const& histogram) noexcept;
+        static int clz(const uint32_t x) noexcept;
+        static int clz(const uint64_t x) noexcept;
+        static int clz(const __uint128_t x) noexcept;
         uint8_t k;
         uint8_t b;
-        std::vector<register_t> registers;
-        std::size_t shift; // optimization
-        hash_t mask;
+        HashBackend backend;
+        std::vector<register_t, memory::RegisterAllocator<register_t>> registers;
         std::size_t total_seen_kmers; // with repetitions = L1 norm
-        double alpha_m;
+        std::shared_ptr<AbundanceFilter> abundance_filter; // k-mers reach the registers once seen often enough
+        std::shared_ptr<SpectrumSketch> spectrum;
+        std::shared_ptr<KmerFilter> kmer_filter;
 };
 
+inline int
+HyperLogLog::clz(const uint32_t x) noexcept
+{
+    return x ? __builtin_clz(x) : (8 * sizeof(hash_t));
+}
+
+inline int 
+HyperLogLog::clz(const uint64_t x) noexcept
+{
+    return x ? __builtin_clzll(x) : (8 * sizeof(hash_t));
+}
+
+inline int 
+HyperLogLog::clz(const __uint128_t x) noexcept
+{
+    const auto high = static_cast<uint64_t>(x >> 64);
+    if (high == 0) return 64 + clz(static_cast<uint64_t>(x));
+    return clz(high);
+}
+
+inline RegisterRank
+HyperLogLog::register_and_rank(const uint64_t h0, const uint64_t h1, const uint8_t msb_length) noexcept
+{
+    // the b most significant bits select the register, the rank is 1 + the leading zeros of the rest
+    const std::size_t shift = 8 * sizeof(hash_t) - msb_length;
+    const hash_t hval = (static_cast<hash_t>(h1) << 64) | h0;
+    const hash_t lsb = hval & ((static_cast<hash_t>(1) << shift) - 1);
+    return {static_cast<std::size_t>(hval >> shift), static_cast<uint8_t>(clz(lsb) + 1 - msb_length)};
+}
+
+template <typename CountZeros>
+inline std::size_t
+HyperLogLog::estimate(const double inverse_power_sum, const std::size_t nregisters, CountZeros&& count_zeros) noexcept
+{
+    // !!! DO NOT compute nregisters**2 first because if b >= 32 we have an integer overflow
+    const double m = static_cast<double>(nregisters);
+    const double alpha_m = 0.7213 / (1 + 1.079 / m);
+    const std::size_t raw_estimate = (alpha_m * (1.0 / inverse_power_sum) * m) * m; // !!!
+    if (raw_estimate <= 2.5 * m) { // linear counting
+        const std::size_t zeros = count_zeros();
+        if (zeros != 0) return static_cast<std::size_t>(m * std::log(m / zeros));
+    }
+    return raw_estimate;
+}
+
 } // namespace sketching
 
 #endif // HYPERLOGLOG_HPP
\ No newline at end of file
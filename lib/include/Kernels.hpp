@@ -0,0 +1,50 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace sketching {
+
+namespace cpu {
+
+struct features_t {
+    bool lzcnt;
+    bool bmi2;
+    bool avx2;
+    bool avx512f;
+    bool avx512bw;
+};
+
+// detected once per process
+features_t const& features() noexcept;
+
+// one "kernel\tselected path" line per dispatched kernel
+std::string dispatch_report();
+
+} // namespace cpu
+
+/**
+ * Register kernels shared by all sketches. Each one is compiled for several x86 levels 
+ * (via target attributes, the build stays baseline x86-64) and bound once to the best 
+ * version the CPU supports. All versions give identical results.
+ */
+namespace kernels {
+
+// registers[h >> (128 - b)] = max(.., rank) for n 128-bit hashes stored as (low, high) word pairs
+void update_registers(uint8_t* registers, uint64_t const* hashes, const std::size_t n, const uint8_t b) noexcept;
+
+// dst[i] = max(dst[i], src[i])
+void merge_max(uint8_t* dst, uint8_t const* src, const std::size_t n) noexcept;
+
+// sum of 2^-registers[i], summed over 8 fixed partial sums so every version rounds alike
+double inverse_power_sum(uint8_t const* registers, const std::size_t n) noexcept;
+
+std::size_t count_zeros(uint8_t const* registers, const std::size_t n) noexcept;
+
+} // namespace kernels
+
+} // namespace sketching
+
+#endif // KERNELS_HPP
@@ -0,0 +1,77 @@
+#ifndef KMER_HASHER_HPP
+#define KMER_HASHER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "HyperLogLog.hpp"
+#include "FixedKNtHash.hpp"
+#include "PackedKmerHash.hpp"
+#include "ValidRuns.hpp"
+
+namespace sketching {
+
+/**
+ * Calls emit(h0, h1) with the two hash words of every k-mer of seq made of ACGT only (h1 is 
+ * the most significant word), the hashes HyperLogLog::add() sketches. k and backend are not 
+ * checked, see KmerHasher.
+ */
+template <typename Emit>
+inline void for_each_kmer_hash(char const * const seq, const std::size_t length, const uint8_t k, const HashBackend backend, Emit&& emit)
+{
+    auto nthash_runs = [&](auto fixed_k) {
+        constexpr uint16_t K = decltype(fixed_k)::value;
+        for_each_valid_run(seq, length, k, [&](char const * const run, const std::size_t run_length) {
+            hash_valid_run<K>(run, run_length, k, [&](uint64_t const* hashes) { emit(hashes[0], hashes[1]); });
+        });
+    };
+    if (backend == HashBackend::packed) {
+        PackedKmerHash hasher(seq, length, k);
+        while (hasher.roll()) emit(hasher.hashes()[0], hasher.hashes()[1]);
+        return;
+    }
+    // common k values get a rolling loop with the rotations folded to constants
+    switch (k) {
+        case 21: return nthash_runs(std::integral_constant<uint16_t, 21>());
+        case 25: return nthash_runs(std::integral_constant<uint16_t, 25>());
+        case 31: return nthash_runs(std::integral_constant<uint16_t, 31>());
+        case 51: return nthash_runs(std::integral_constant<uint16_t, 51>());
+        case 63: return nthash_runs(std::integral_constant<uint16_t, 63>());
+        default: return nthash_runs(std::integral_constant<uint16_t, 0>());
+    }
+}
+
+/**
+ * k-mer hashing without a sketch, for structures keeping their own registers 
+ * (see HyperLogLog::register_and_rank).
+ */
+class KmerHasher
+{
+    public:
+        KmerHasher(const uint8_t kmer_length, const HashBackend hash_backend)
+            : k(kmer_length), backend(hash_backend)
+        {
+            if (k == 0 or k > 64) throw std::invalid_argument("[KmerHasher] k-mer length should be 0 < k <= 64");
+            if (backend != HashBackend::nthash and backend != HashBackend::packed) throw std::invalid_argument("[KmerHasher] Unknown hash backend");
+            if (backend == HashBackend::packed and k > 32) throw std::invalid_argument("[KmerHasher] The packed hash backend requires k <= 32");
+        }
+
+        template <typename Emit>
+        void for_each_hash(char const * const seq, const std::size_t length, Emit&& emit) const
+        {
+            for_each_kmer_hash(seq, length, k, backend, emit);
+        }
+
+        uint8_t kmer_length() const noexcept { return k; }
+        HashBackend hash_backend() const noexcept { return backend; }
+
+    private:
+        uint8_t k;
+        HashBackend backend;
+};
+
+} // namespace sketching
+
+#endif // KMER_HASHER_HPP
@@ -0,0 +1,49 @@
+#ifndef MULTI_LANE_NTHASH_HPP
+#define MULTI_LANE_NTHASH_HPP
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace sketching {
+
+/**
+ * ntHash over a batch of sequences, advancing one independent sequence per SIMD lane
+ * (8 lanes with AVX-512, 4 with AVX2 or the portable fallback) in lockstep.
+ * Lanes reset on N and pick up the next sequence of the batch as soon as theirs ends.
+ * Produces exactly the hashes of nthash::NtHash with 2 hashes per k-mer, 
+ * written as (h0, h1) pairs into an internal buffer handed to the caller when full.
+ * Sequences shorter than k produce no hash.
+ * The hash buffer is allocated once, reset() switches k without allocating.
+ */
+class MultiLaneNtHash
+{
+    public:
+        using flush_t = std::function<void(uint64_t const* hashes, std::size_t nkmers)>;
+        MultiLaneNtHash(const uint16_t kmer_length);
+        void reset(const uint16_t kmer_length) noexcept;
+        uint16_t get_k() const noexcept { return k; }
+        void hash(std::vector<std::string_view> const& batch, flush_t const& flush);
+        static unsigned lanes() noexcept;
+        static char const* path() noexcept; // kernel selected for this CPU
+
+        static constexpr std::size_t buffer_kmers = 4096;
+        struct tables_t {
+            std::array<uint64_t, 256> fwd_in; // SEED_TAB[c], 0 for invalid characters
+            std::array<uint64_t, 256> fwd_out; // srol^k(SEED_TAB[c])
+            std::array<uint64_t, 256> rev_in; // srol^k(SEED_TAB[c & CP_OFF])
+            std::array<uint64_t, 256> rev_out; // SEED_TAB[c & CP_OFF]
+        };
+
+    private:
+        uint16_t k;
+        uint64_t multiplier; // second hash as in nthash::extend_hashes
+        tables_t tables;
+        std::vector<uint64_t> buffer;
+};
+
+} // namespace sketching
+
+#endif // MULTI_LANE_NTHASH_HPP
@@ -0,0 +1,99 @@
+#ifndef PACKED_KMER_HASH_HPP
+#define PACKED_KMER_HASH_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace sketching {
+
+/**
+ * Rolling hash for k <= 32 over 2-bit packed forward and reverse-complement words.
+ * The canonical word (minimum of the two strands) goes through two invertible
+ * 64-bit mixers, giving the 128 bits used by the sketch.
+ * Same roll()/hashes() protocol as nthash::NtHash, N (and any non ACGTU) resets the window.
+ */
+class PackedKmerHash
+{
+    public:
+        PackedKmerHash(char const * const seq, const std::size_t seq_len, const uint8_t kmer_length) noexcept
+            : seq(seq), 
+              seq_len(seq_len), 
+              k(kmer_length), 
+              pos(0), 
+              valid(0), 
+              kmask(kmer_length == 32 ? ~uint64_t(0) : ((uint64_t(1) << (2 * kmer_length)) - 1)), 
+              rc_shift(2 * (kmer_length - 1)), 
+              fwd(0), 
+              rev(0)
+        {}
+
+        bool roll() noexcept
+        {
+            while (pos < seq_len) {
+                const uint8_t c = code(seq[pos++]);
+                if (c > 3) {
+                    valid = 0;
+                    continue;
+                }
+                fwd = ((fwd << 2) | c) & kmask;
+                rev = (rev >> 2) | (uint64_t(3 - c) << rc_shift);
+                if (++valid >= k) {
+                    const uint64_t canonical = fwd < rev ? fwd : rev;
+                    hash_arr[0] = mix_lo(canonical);
+                    hash_arr[1] = mix_hi(canonical);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        uint64_t const* hashes() const noexcept { return hash_arr; }
+
+        static uint8_t code(const char c) noexcept { return codes[static_cast<unsigned char>(c)]; }
+
+        // murmur3 fmix64 (invertible)
+        static uint64_t mix_hi(uint64_t x) noexcept
+        {
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+        // splitmix64 finalizer on an offset input (invertible)
+        static uint64_t mix_lo(uint64_t x) noexcept
+        {
+            x += 0x9e3779b97f4a7c15ULL;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+
+    private:
+        static constexpr std::array<uint8_t, 256> codes = [] {
+            std::array<uint8_t, 256> table{};
+            for (auto& c : table) c = 4;
+            table['A'] = table['a'] = 0;
+            table['C'] = table['c'] = 1;
+            table['G'] = table['g'] = 2;
+            table['T'] = table['t'] = table['U'] = table['u'] = 3;
+            return table;
+        }();
+        char const * seq;
+        std::size_t seq_len;
+        uint8_t k;
+        std::size_t pos;
+        std::size_t valid; // length of the current run of valid bases
+        uint64_t kmask;
+        unsigned rc_shift;
+        uint64_t fwd;
+        uint64_t rev;
+        uint64_t hash_arr[2];
+};
+
+} // namespace sketching
+
+#endif // PACKED_KMER_HASH_HPP
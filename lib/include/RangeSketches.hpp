@@ -0,0 +1,54 @@
+#ifndef RANGE_SKETCHES_HPP
+#define RANGE_SKETCHES_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "HyperLogLog.hpp"
+
+namespace sketching {
+
+/**
+ * Sketches of consecutive blocks of input records, stored with pre-merged sketches of aligned 
+ * runs of blocks in one file. Node (h, j) is the union of blocks [j 2^h, (j + 1) 2^h), written 
+ * as soon as its last block closes: only one pending left child per level stays in memory. 
+ * Every node has the same size on disk, so a query for a range of records reads and merges 
+ * the O(log n) largest aligned nodes covering its blocks only.
+ */
+class RangeSketches
+{
+    public:
+        struct range_t {
+            uint64_t first; // records [first, last) covered by the blocks of the query
+            uint64_t last;
+            HyperLogLog sketch;
+        };
+
+        RangeSketches(std::string const& filename, const uint64_t block_records);
+        RangeSketches(RangeSketches const&) = delete;
+        RangeSketches& operator=(RangeSketches const&) = delete;
+
+        void add_block(HyperLogLog const& block, const uint64_t nrecords); // in input order, only the last block may be partial
+        std::size_t size() const noexcept;
+        void finish(); // writes the header, the file is not valid before
+
+        // union of the records [first, last), widened to whole blocks
+        static range_t query(std::string const& filename, const uint64_t first, const uint64_t last);
+
+    private:
+        std::string filename;
+        std::ofstream ostrm;
+        uint64_t block_records;
+        uint64_t records;
+        uint64_t nblocks;
+        uint64_t node_bytes;
+        std::vector<HyperLogLog> pending; // pending[h] is a left child waiting for its sibling when bit h of nblocks is set
+
+        void write(HyperLogLog const& node);
+};
+
+} // namespace sketching
+
+#endif // RANGE_SKETCHES_HPP
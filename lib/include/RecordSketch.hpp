@@ -0,0 +1,42 @@
+#ifndef RECORD_SKETCH_HPP
+#define RECORD_SKETCH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "HyperLogLog.hpp"
+#include "KmerHasher.hpp"
+#include "RegisterMemory.hpp"
+
+namespace sketching {
+
+/**
+ * HLL sketch reused across many small inputs (one read or contig at a time). The registers 
+ * set since the last clear() are listed, so clear() and count() cost O(registers touched) 
+ * instead of O(2^b): untouched registers are known to be zero. count() gives the same 
+ * estimate as HyperLogLog::count() on the same k-mers.
+ */
+class RecordSketch
+{
+    public:
+        RecordSketch(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend);
+        RecordSketch(RecordSketch const&) = delete;
+        RecordSketch& operator=(RecordSketch const&) = delete;
+
+        void add(char const * const seq, const std::size_t length) noexcept;
+        void clear() noexcept;
+        std::size_t count() const noexcept;
+        std::size_t touched() const noexcept;
+
+    private:
+        uint8_t b;
+        KmerHasher hasher;
+        std::vector<uint8_t, memory::RegisterAllocator<uint8_t>> registers;
+        std::vector<uint32_t> touched_registers;
+
+        void update(const RegisterRank update) noexcept;
+};
+
+} // namespace sketching
+
+#endif // RECORD_SKETCH_HPP
@@ -0,0 +1,92 @@
+#ifndef REGISTER_MEMORY_HPP
+#define REGISTER_MEMORY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace sketching {
+
+/**
+ * Memory for sketch registers. Blocks of at least 2 MiB are anonymous mappings: zero pages 
+ * are handed out lazily by the kernel, backed by transparent or reserved huge pages and 
+ * optionally interleaved or placed on a NUMA node. Smaller blocks come from calloc.
+ * Every block is zero when allocated.
+ */
+namespace memory {
+
+enum class HugePages : uint8_t {off, transparent, hugetlb};
+
+struct options_t {
+    std::size_t budget; // bytes of registers alive at the same time, physical memory by default
+    HugePages huge_pages;
+    int numa_node; // -1 = no placement, -2 = interleave over all nodes, >= 0 preferred node
+};
+
+// process-wide, set before building sketches
+options_t& options() noexcept;
+
+// throws if bytes more would exceed the budget
+void check_budget(const std::size_t bytes);
+
+void* allocate(const std::size_t bytes);
+void deallocate(void* ptr, const std::size_t bytes) noexcept;
+
+// zero a block returned by allocate(), mapped pages are dropped instead of written
+void zero(void* ptr, const std::size_t bytes) noexcept;
+
+// "4096", "512M", "8G" or "1T"
+std::size_t parse_size(std::string const& size);
+
+HugePages huge_pages_from_string(std::string const& name);
+
+// "none", "interleave" or a node number
+int numa_from_string(std::string const& name);
+
+/**
+ * Allocator for register vectors. Elements are default-initialized, so resize() 
+ * relies on the zero pages of allocate() instead of writing every register.
+ */
+template <typename T>
+struct RegisterAllocator {
+    using value_type = T;
+
+    RegisterAllocator() noexcept = default;
+    template <typename U> RegisterAllocator(RegisterAllocator<U> const&) noexcept {}
+
+    T* allocate(const std::size_t n) 
+    {
+        return static_cast<T*>(memory::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, const std::size_t n) noexcept 
+    {
+        memory::deallocate(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U* ptr) noexcept 
+    {
+        ::new(static_cast<void*>(ptr)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* ptr, Args&&... args) 
+    {
+        ::new(static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(RegisterAllocator<T> const&, RegisterAllocator<U> const&) noexcept { return true; }
+
+template <typename T, typename U>
+bool operator!=(RegisterAllocator<T> const&, RegisterAllocator<U> const&) noexcept { return false; }
+
+} // namespace memory
+
+} // namespace sketching
+
+#endif // REGISTER_MEMORY_HPP
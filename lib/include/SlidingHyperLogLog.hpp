@@ -0,0 +1,49 @@
+#ifndef SLIDING_HYPERLOGLOG_HPP
+#define SLIDING_HYPERLOGLOG_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "HyperLogLog.hpp"
+#include "KmerHasher.hpp"
+#include "RegisterMemory.hpp"
+
+namespace sketching {
+
+/**
+ * Sliding-window HyperLogLog (Chabchoub and Hebrail, "Sliding HyperLogLog"). Every register 
+ * keeps its list of possible future maxima (LPFM): the (timestamp, rank) pairs that are still 
+ * the largest rank of some window ending now. Timestamps increase and ranks decrease along 
+ * a list, so an update pops the dominated pairs from the back and pushes one (amortized O(1)), 
+ * and the register of a window is the first pair of the list inside it. Time is any 
+ * non-decreasing counter set by advance(), e.g. reads or seconds. Any window up to max_window 
+ * can be queried at any time.
+ */
+class SlidingHyperLogLog
+{
+    public:
+        SlidingHyperLogLog(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend, const uint64_t max_window);
+        SlidingHyperLogLog(SlidingHyperLogLog const&) = delete;
+        SlidingHyperLogLog& operator=(SlidingHyperLogLog const&) = delete;
+
+        void advance(const uint64_t timestamp);
+        void add(char const * const seq, const std::size_t length); // throws std::bad_alloc past the register budget
+        uint64_t time() const noexcept;
+        HyperLogLog snapshot(uint64_t window) const; // k-mers seen in (time() - window, time()], without total k-mers
+        std::size_t count(const uint64_t window) const;
+
+    private:
+        using list_t = std::vector<uint64_t, memory::RegisterAllocator<uint64_t>>;
+
+        uint8_t b;
+        uint64_t max_window;
+        uint64_t now;
+        KmerHasher hasher;
+        std::vector<list_t, memory::RegisterAllocator<list_t>> lists; // per register, timestamp << 8 | rank. Headers and pairs count against the register budget
+
+        void update(const RegisterRank update);
+};
+
+} // namespace sketching
+
+#endif // SLIDING_HYPERLOGLOG_HPP
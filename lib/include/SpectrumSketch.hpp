@@ -0,0 +1,48 @@
+#ifndef SPECTRUM_SKETCH_HPP
+#define SPECTRUM_SKETCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace sketching {
+
+/**
+ * k-mer abundance spectrum from exact counts of a hash-sampled fraction of the k-mers.
+ * A k-mer is sampled iff its hash is <= threshold, so all its occurrences are counted together. 
+ * When more than capacity k-mers are sampled the threshold halves and the k-mers above it are 
+ * dropped, which keeps memory fixed and the sample uniform. Spectrum entries are the sampled 
+ * counts divided by the sampled fraction. Safe to share between threads.
+ */
+class SpectrumSketch
+{
+    public:
+        explicit SpectrumSketch(const std::size_t capacity);
+
+        void add(const uint64_t hash) noexcept
+        {
+            if (hash > threshold.load(std::memory_order_relaxed)) return;
+            insert(hash);
+        }
+
+        double fraction() const noexcept;
+        std::size_t sampled() const;
+        std::map<uint32_t, double> spectrum() const; // abundance -> estimated number of distinct k-mers
+        void store(std::string const& filename) const; // TSV of abundance and k-mers
+
+    private:
+        std::size_t capacity;
+        std::atomic<uint64_t> threshold;
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, uint32_t> counts;
+
+        void insert(const uint64_t hash) noexcept;
+};
+
+} // namespace sketching
+
+#endif // SPECTRUM_SKETCH_HPP
@@ -0,0 +1,111 @@
+#ifndef VALID_RUNS_HPP
+#define VALID_RUNS_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace sketching {
+
+namespace valid_runs {
+
+inline bool is_valid(const char c) noexcept
+{
+    const auto x = static_cast<unsigned char>(c) | 0x20;
+    return x == 'a' or x == 'c' or x == 'g' or x == 't' or x == 'u';
+}
+
+// bit i set iff block[i] is a nucleotide, any case (U counts as T as in ntHash)
+inline uint64_t block_mask(char const * const block) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a');
+    const __m128i c = _mm_set1_epi8('c');
+    const __m128i g = _mm_set1_epi8('g');
+    const __m128i t = _mm_set1_epi8('t');
+    const __m128i u = _mm_set1_epi8('u');
+    uint64_t mask = 0;
+    for (std::size_t i = 0; i < 64; i += 16) {
+        const __m128i x = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(block + i)), lower);
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(x, a), _mm_cmpeq_epi8(x, c));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(x, g));
+        hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(x, t), _mm_cmpeq_epi8(x, u)));
+        mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hit))) << i;
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (std::size_t i = 0; i < 64; ++i) mask |= static_cast<uint64_t>(is_valid(block[i])) << i;
+    return mask;
+#endif
+}
+
+inline uint64_t tail_mask(char const * const block, const std::size_t n) noexcept
+{
+    uint64_t mask = 0;
+    for (std::size_t i = 0; i < n; ++i) mask |= static_cast<uint64_t>(is_valid(block[i])) << i;
+    return mask;
+}
+
+} // namespace valid_runs
+
+/**
+ * dst[i] = qual[i] < min_qual ? 'N' : seq[i], so k-mers covering low quality bases are skipped like those covering N.
+ * min_qual is a quality character (Phred + 33), dst may be seq.
+ */
+inline void mask_low_quality(char const * const seq, char const * const qual, const std::size_t length, const char min_qual, char * const dst) noexcept
+{
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i threshold = _mm_set1_epi8(min_qual); // quality characters are < 128, the signed compare is safe
+    const __m128i n = _mm_set1_epi8('N');
+    for (; i + 16 <= length; i += 16) {
+        const __m128i q = _mm_loadu_si128(reinterpret_cast<__m128i const*>(qual + i));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(seq + i));
+        const __m128i low = _mm_cmplt_epi8(q, threshold);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(_mm_and_si128(low, n), _mm_andnot_si128(low, s)));
+    }
+#endif
+    for (; i < length; ++i) dst[i] = qual[i] < min_qual ? 'N' : seq[i];
+}
+
+/**
+ * Call f(run, run_length) for every maximal run of nucleotides with run_length >= min_length.
+ * Validity is classified 64 bases at a time, so hashers can roll over runs without per-base checks.
+ */
+template <typename F>
+void for_each_valid_run(char const * const seq, const std::size_t length, const std::size_t min_length, F&& f)
+{
+    bool in_run = false;
+    std::size_t start = 0;
+    for (std::size_t offset = 0; offset < length; offset += 64) {
+        const std::size_t n = length - offset < 64 ? length - offset : 64;
+        const uint64_t valid = n == 64 ? valid_runs::block_mask(seq + offset) : valid_runs::tail_mask(seq + offset, n);
+        std::size_t pos = offset;
+        while (pos < offset + n) {
+            const std::size_t bit = pos - offset;
+            if (in_run) {
+                const uint64_t invalid = ~valid >> bit;
+                if (invalid == 0) break; // run goes on in the next block
+                pos += __builtin_ctzll(invalid);
+                if (pos - start >= min_length) f(seq + start, pos - start);
+                in_run = false;
+            } else {
+                const uint64_t next = valid >> bit;
+                if (next == 0) break;
+                pos += __builtin_ctzll(next);
+                start = pos;
+                in_run = true;
+            }
+        }
+    }
+    if (in_run and length - start >= min_length) f(seq + start, length - start);
+}
+
+} // namespace sketching
+
+#endif // VALID_RUNS_HPP
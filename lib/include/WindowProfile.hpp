@@ -0,0 +1,60 @@
+#ifndef WINDOW_PROFILE_HPP
+#define WINDOW_PROFILE_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "HyperLogLog.hpp"
+#include "KmerHasher.hpp"
+
+namespace sketching {
+
+struct window_t {
+    std::size_t start;
+    std::size_t end;
+    std::size_t estimate; // distinct k-mers starting in [start, end)
+};
+
+/**
+ * Distinct k-mers in windows sliding along a sequence. Windows of a given size start every step 
+ * bases, so every k-mer falls into size / step windows that are sketched at the same time. Each 
+ * window has a small HLL with a martingale (HIP) estimator, which grows by 1 / P(change) whenever 
+ * a register increases: the estimate is always up to date and a window closes in O(1). Registers 
+ * touched by a window are listed so that reusing its sketch costs O(touched), not O(2^b). 
+ * The hash of every k-mer is computed once.
+ */
+class WindowProfile
+{
+    public:
+        WindowProfile(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend, const std::size_t window, const std::size_t step);
+        WindowProfile(WindowProfile const&) = delete;
+        WindowProfile& operator=(WindowProfile const&) = delete;
+
+        // windows in order, each with at least one k-mer start, the last one ends with the sequence. None if the sequence is shorter than k
+        std::vector<window_t> profile(char const * const seq, const std::size_t length);
+
+    private:
+        struct slot_t {
+            double estimate = 0;
+            double inverse_sum = 0; // sum of 2^-r over all registers
+            std::vector<uint32_t> touched;
+        };
+
+        uint8_t b;
+        std::size_t m;
+        std::size_t window;
+        std::size_t step;
+        KmerHasher hasher;
+        std::vector<uint8_t> registers; // m per slot
+        std::vector<slot_t> slots; // window i lives in slot i % (window / step)
+        std::vector<std::size_t> active; // slots of the windows holding the current k-mers
+        std::array<double, 256> inverse_powers;
+
+        void update(const RegisterRank update) noexcept;
+        void reset(const std::size_t slot) noexcept;
+};
+
+} // namespace sketching
+
+#endif // WINDOW_PROFILE_HPP
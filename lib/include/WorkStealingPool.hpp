@@ -0,0 +1,130 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sketching {
+
+/**
+ * Fixed set of workers, each with its own task deque. Tasks are spread round-robin, 
+ * a worker runs its own tasks newest first and steals the oldest task of another 
+ * worker when it runs out. Tasks receive the index of the worker running them.
+ * submit() blocks while max_pending tasks are queued or running, bounding memory.
+ */
+class WorkStealingPool
+{
+    public:
+        using task_t = std::function<void(std::size_t worker)>;
+
+        WorkStealingPool(const std::size_t nthreads, const std::size_t max_pending)
+            : max_pending(max_pending ? max_pending : 1), pending(0), queued(0), next(0), stopping(false)
+        {
+            for (std::size_t i = 0; i < nthreads; ++i) queues.push_back(std::make_unique<queue_t>());
+            for (std::size_t i = 0; i < nthreads; ++i) workers.emplace_back(&WorkStealingPool::run, this, i);
+        }
+
+        ~WorkStealingPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                stopping = true;
+            }
+            work_available.notify_all();
+            for (auto& w : workers) w.join();
+        }
+
+        std::size_t size() const noexcept { return workers.size(); }
+
+        void submit(task_t task)
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            task_done.wait(lock, [this] { return pending < max_pending; });
+            ++pending;
+            auto& q = *queues[next++ % queues.size()];
+            {
+                std::lock_guard<std::mutex> qlock(q.mutex);
+                q.tasks.push_back(std::move(task));
+            }
+            ++queued;
+            lock.unlock();
+            work_available.notify_one();
+        }
+
+        // returns once every submitted task has run
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            task_done.wait(lock, [this] { return pending == 0; });
+        }
+
+    private:
+        struct queue_t {
+            std::mutex mutex;
+            std::deque<task_t> tasks;
+        };
+
+        std::size_t max_pending;
+        std::size_t pending; // queued or running
+        std::size_t queued; // tasks sitting in some deque, each one claimed by exactly one worker
+        std::size_t next;
+        bool stopping;
+        std::mutex state_mutex;
+        std::condition_variable work_available;
+        std::condition_variable task_done;
+        std::vector<std::unique_ptr<queue_t>> queues;
+        std::vector<std::thread> workers;
+
+        bool pop(const std::size_t id, task_t& task)
+        {
+            auto& own = *queues[id];
+            {
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (not own.tasks.empty()) {
+                    task = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    return true;
+                }
+            }
+            for (std::size_t i = 1; i < queues.size(); ++i) {
+                auto& victim = *queues[(id + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (not victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void run(const std::size_t id)
+        {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(state_mutex);
+                    work_available.wait(lock, [this] { return queued > 0 or stopping; });
+                    if (queued == 0) return; // stopping with nothing left
+                    --queued;
+                }
+                task_t task;
+                while (not pop(id, task)) std::this_thread::yield(); // the claimed task is being pushed
+                task(id);
+                {
+                    std::lock_guard<std::mutex> lock(state_mutex);
+                    --pending;
+                }
+                task_done.notify_all();
+            }
+        }
+};
+
+} // namespace sketching
+
+#endif // WORK_STEALING_POOL_HPP
@@ -417,6 +417,19 @@ public:
 
   SeedNtHash(SeedNtHash&&) = default;
 
+  /**
+   * Point the hasher to a new sequence, reusing its seeds and hash buffers.
+   * @param seq C-string of the sequence to be hashed
+   * @param seq_len Length of the sequence
+   * @param pos Position in seq to start hashing from
+   */
+  void change_seq(const char* seq, size_t seq_len, size_t pos = 0)
+  {
+    this->seq = std::string_view(seq, seq_len);
+    this->pos = pos;
+    initialized = false;
+  }
+
   /**
    * Calculate the next hash value. Refer to \ref NtHash::roll() for more
    * information.
@@ -10,6 +10,7 @@ using nthash::MULTISHIFT;
 using nthash::raise_error;
 using nthash::raise_warning;
 using nthash::SEED_N;
+using nthash::SEED_TAB;
 using nthash::srol;
 using nthash::srol_table;
 using nthash::sror;
@@ -148,7 +149,7 @@ ntmsm64(const char* kmer_seq,
     rh_seed = 0;
     for (const auto& block : seeds_blocks[i_seed]) {
       for (unsigned pos = block[0]; pos < block[1]; pos++) {
-        if (kmer_seq[pos] == SEED_N) {
+        if (SEED_TAB[(unsigned char)kmer_seq[pos]] == SEED_N) {
           loc_n = pos;
           return false;
         }
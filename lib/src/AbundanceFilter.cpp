@@ -0,0 +1,17 @@
+#include "../include/AbundanceFilter.hpp"
+#include <stdexcept>
+#include <string>
+
+namespace sketching {
+
+AbundanceFilter::AbundanceFilter(const std::size_t bytes, const uint8_t min_abundance, const bool concurrent)
+    : width(1), threshold(min_abundance), concurrent(concurrent)
+{
+    if (min_abundance < 1) throw std::invalid_argument("[AbundanceFilter] minimum abundance should be >= 1");
+    if (bytes < rows) throw std::invalid_argument("[AbundanceFilter] at least " + std::to_string(rows) + " bytes are needed");
+    while (2 * width * rows <= bytes) width *= 2; // largest power of 2 fitting the budget
+    width_mask = width - 1;
+    counters.resize(width * rows);
+}
+
+} // namespace sketching
@@ -0,0 +1,166 @@
+#include "../include/BarcodeSketches.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace sketching {
+
+namespace {
+
+constexpr char demux_magic[8] = {'K', 'H', 'L', 'L', 'D', 'M', 'X', '1'};
+constexpr std::size_t rank_bits = 8;
+constexpr std::size_t max_sparse_b = 32 - rank_bits;
+
+} // namespace
+
+BarcodeSketches::BarcodeSketches(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend)
+    : b(msb_length), hasher(kmer_length, hash_backend), nslots(0)
+{
+    if (b == 0 or b > max_sparse_b) throw std::invalid_argument("[BarcodeSketches] Number of indexing bits should be in [1, " + std::to_string(max_sparse_b) + "]");
+    m = std::size_t(1) << b;
+    per_block = std::max(block_bytes / m, std::size_t(1));
+}
+
+void
+BarcodeSketches::add(std::string_view barcode, char const * const seq, const std::size_t length)
+{
+    auto [itr, inserted] = index.try_emplace(std::string(barcode), static_cast<uint32_t>(entries.size()));
+    if (inserted) {
+        entries.emplace_back();
+        entries.back().name = itr->first;
+    }
+    auto& entry = entries[itr->second];
+    ++entry.reads;
+    hasher.for_each_hash(seq, length, [&](const uint64_t h0, const uint64_t h1) {
+        ++entry.total;
+        insert(entry, HyperLogLog::register_and_rank(h0, h1, b));
+    });
+}
+
+void
+BarcodeSketches::insert(entry_t& entry, const RegisterRank update)
+{
+    if (entry.registers != no_registers) {
+        auto& r = registers_of(entry)[update.index];
+        if (update.rank > r) r = update.rank;
+        return;
+    }
+    entry.sparse.push_back(static_cast<uint32_t>(update.index) << rank_bits | update.rank);
+    if (entry.sparse.size() - entry.compacted >= std::max(entry.compacted, std::size_t(32))) compact(entry);
+}
+
+void
+BarcodeSketches::compact(entry_t& entry)
+{
+    // sorted by register then rank, the last entry of a register holds its maximum
+    auto& sparse = entry.sparse;
+    std::sort(sparse.begin() + entry.compacted, sparse.end());
+    std::inplace_merge(sparse.begin(), sparse.begin() + entry.compacted, sparse.end());
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < sparse.size(); ++i) {
+        if (i + 1 < sparse.size() and (sparse[i] >> rank_bits) == (sparse[i + 1] >> rank_bits)) continue;
+        sparse[n++] = sparse[i];
+    }
+    sparse.resize(n);
+    entry.compacted = n;
+    if (n * sizeof(uint32_t) >= m) promote(entry);
+}
+
+void
+BarcodeSketches::promote(entry_t& entry)
+{
+    if (nslots % per_block == 0) {
+        memory::check_budget(per_block * m);
+        blocks.emplace_back(per_block * m);
+    }
+    entry.registers = static_cast<uint32_t>(nslots++);
+    auto regs = registers_of(entry);
+    for (auto e : entry.sparse) regs[e >> rank_bits] = e & 0xFF; // compacted, one entry per register
+    std::vector<uint32_t>().swap(entry.sparse);
+    entry.compacted = 0;
+}
+
+uint8_t*
+BarcodeSketches::registers_of(entry_t const& entry) const noexcept
+{
+    return const_cast<uint8_t*>(blocks[entry.registers / per_block].data()) + (entry.registers % per_block) * m;
+}
+
+std::size_t
+BarcodeSketches::size() const noexcept
+{
+    return entries.size();
+}
+
+std::size_t
+BarcodeSketches::dense() const noexcept
+{
+    return nslots;
+}
+
+std::string const&
+BarcodeSketches::barcode(const std::size_t i) const noexcept
+{
+    return entries[i].name;
+}
+
+std::size_t
+BarcodeSketches::reads(const std::size_t i) const noexcept
+{
+    return entries[i].reads;
+}
+
+HyperLogLog
+BarcodeSketches::sketch(const std::size_t i) const
+{
+    auto const& entry = entries.at(i);
+    if (entry.registers != no_registers) return HyperLogLog(hasher.kmer_length(), b, hasher.hash_backend(), registers_of(entry), entry.total);
+    std::vector<uint8_t> dense(m, 0);
+    for (auto e : entry.sparse) dense[e >> rank_bits] = std::max(dense[e >> rank_bits], static_cast<uint8_t>(e & 0xFF));
+    return HyperLogLog(hasher.kmer_length(), b, hasher.hash_backend(), dense.data(), entry.total);
+}
+
+void
+BarcodeSketches::store(std::string const& filename) const
+{
+    std::ofstream ostrm(filename, std::ios::binary);
+    if (not ostrm) throw std::runtime_error("[BarcodeSketches] Unable to write " + filename);
+    const uint64_t n = entries.size();
+    ostrm.write(demux_magic, sizeof(demux_magic));
+    ostrm.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const uint32_t name_length = static_cast<uint32_t>(entries[i].name.size());
+        const uint64_t nreads = entries[i].reads;
+        ostrm.write(reinterpret_cast<const char*>(&name_length), sizeof(name_length));
+        ostrm.write(entries[i].name.data(), name_length);
+        ostrm.write(reinterpret_cast<const char*>(&nreads), sizeof(nreads));
+        sketch(i).store(ostrm);
+    }
+}
+
+std::vector<barcode_sketch_t>
+BarcodeSketches::load(std::string const& filename)
+{
+    std::ifstream istrm(filename, std::ios::binary);
+    char magic[sizeof(demux_magic)];
+    uint64_t n = 0;
+    istrm.read(magic, sizeof(magic));
+    istrm.read(reinterpret_cast<char*>(&n), sizeof(n));
+    if (not istrm or std::memcmp(magic, demux_magic, sizeof(magic)) != 0) throw std::runtime_error("[BarcodeSketches] " + filename + " is not a demux sketch file");
+    std::vector<barcode_sketch_t> sketches;
+    for (uint64_t i = 0; i < n; ++i) {
+        uint32_t name_length = 0;
+        uint64_t nreads = 0;
+        istrm.read(reinterpret_cast<char*>(&name_length), sizeof(name_length));
+        std::string name(name_length, '\0');
+        istrm.read(name.data(), name_length);
+        istrm.read(reinterpret_cast<char*>(&nreads), sizeof(nreads));
+        HyperLogLog hll(istrm);
+        if (not istrm) throw std::runtime_error("[BarcodeSketches] Truncated demux sketch file " + filename);
+        sketches.push_back({std::move(name), nreads, std::move(hll)});
+    }
+    return sketches;
+}
+
+} // namespace sketching
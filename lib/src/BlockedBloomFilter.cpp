@@ -0,0 +1,124 @@
+#include "../include/BlockedBloomFilter.hpp"
+#include "../include/RegisterMemory.hpp"
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sketching {
+
+namespace {
+
+// 64-byte header, the blocks start on a cache line
+struct bloom_header_t {
+    char magic[8];
+    uint8_t backend;
+    uint8_t k;
+    uint8_t probes;
+    uint8_t padding[5];
+    uint64_t nblocks;
+    uint8_t reserved[40];
+};
+
+static_assert(sizeof(bloom_header_t) == BlockedBloomFilter::block_bytes, "bloom filter header must be one cache line");
+
+constexpr char bloom_magic[8] = {'K', 'H', 'L', 'L', 'B', 'L', 'M', '1'};
+
+} // namespace
+
+BlockedBloomFilter::BlockedBloomFilter() noexcept
+    : k(0), backend(HashBackend::nthash), nprobes(0), nblocks(0), blocks(nullptr), mapping(nullptr), mapping_length(0)
+{}
+
+BlockedBloomFilter::BlockedBloomFilter(const std::size_t bytes, const uint8_t kmer_length, const HashBackend hash_backend, const uint8_t probes)
+    : k(kmer_length), backend(hash_backend), nprobes(probes), nblocks(bytes / block_bytes), blocks(nullptr), mapping(nullptr), mapping_length(0)
+{
+    if (nprobes < 1 or nprobes > 7) throw std::invalid_argument("[BlockedBloomFilter] number of probes should be in [1, 7]");
+    if (nblocks == 0) throw std::invalid_argument("[BlockedBloomFilter] at least " + std::to_string(block_bytes) + " bytes are needed");
+    blocks = static_cast<uint64_t*>(memory::allocate(nblocks * block_bytes)); // zero, lazily
+}
+
+BlockedBloomFilter::BlockedBloomFilter(BlockedBloomFilter&& other) noexcept
+    : k(other.k), 
+      backend(other.backend), 
+      nprobes(other.nprobes), 
+      nblocks(other.nblocks), 
+      blocks(other.blocks), 
+      mapping(other.mapping), 
+      mapping_length(other.mapping_length)
+{
+    other.blocks = nullptr;
+    other.mapping = nullptr;
+}
+
+BlockedBloomFilter::~BlockedBloomFilter()
+{
+    if (mapping) munmap(mapping, mapping_length);
+    else if (blocks) memory::deallocate(blocks, nblocks * block_bytes);
+}
+
+double
+BlockedBloomFilter::false_positive_rate(const std::size_t distinct_kmers) const noexcept
+{
+    // standard approximation, blocking adds a little on top
+    const double bits = static_cast<double>(bytes()) * 8;
+    return std::pow(1 - std::exp(-static_cast<double>(nprobes) * distinct_kmers / bits), nprobes);
+}
+
+void
+BlockedBloomFilter::store(std::string const& filename) const
+{
+    bloom_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, bloom_magic, sizeof(bloom_magic));
+    header.backend = static_cast<uint8_t>(backend);
+    header.k = k;
+    header.probes = nprobes;
+    header.nblocks = nblocks;
+    std::ofstream ostrm(filename, std::ios::binary);
+    ostrm.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    ostrm.write(reinterpret_cast<char const*>(blocks), nblocks * block_bytes);
+    if (not ostrm) throw std::runtime_error("unable to write bloom filter " + filename);
+}
+
+BlockedBloomFilter
+BlockedBloomFilter::load(std::string const& filename)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("unable to open bloom filter " + filename);
+    struct stat st;
+    if (fstat(fd, &st) != 0 or static_cast<std::size_t>(st.st_size) < sizeof(bloom_header_t)) {
+        close(fd);
+        throw std::runtime_error("invalid bloom filter " + filename);
+    }
+    const std::size_t length = st.st_size;
+    void* ptr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) throw std::runtime_error("unable to map bloom filter " + filename);
+    bloom_header_t header;
+    std::memcpy(&header, ptr, sizeof(header));
+    if (std::memcmp(header.magic, bloom_magic, sizeof(bloom_magic)) != 0 or 
+        header.backend > static_cast<uint8_t>(HashBackend::packed) or 
+        header.probes < 1 or header.probes > 7 or 
+        header.nblocks == 0 or 
+        length != sizeof(header) + header.nblocks * block_bytes) {
+        munmap(ptr, length);
+        throw std::runtime_error("invalid bloom filter " + filename);
+    }
+    madvise(ptr, length, MADV_RANDOM); // single cache line per lookup, no readahead
+    BlockedBloomFilter filter;
+    filter.k = header.k;
+    filter.backend = static_cast<HashBackend>(header.backend);
+    filter.nprobes = header.probes;
+    filter.nblocks = header.nblocks;
+    filter.blocks = reinterpret_cast<uint64_t*>(static_cast<char*>(ptr) + sizeof(header));
+    filter.mapping = ptr;
+    filter.mapping_length = length;
+    return filter;
+}
+
+} // namespace sketching
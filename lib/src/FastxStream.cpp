@@ -0,0 +1,178 @@
+#include "../include/FastxStream.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace sketching {
+
+FastxStream::FastxStream(gzFile fp, const std::size_t chunk_size, const std::size_t overlap, const std::size_t max_queued)
+    : fp(fp), 
+      chunk_size(std::max(chunk_size, 2 * overlap + 1)), 
+      overlap(overlap), 
+      max_queued(max_queued ? max_queued : 1), 
+      begin(0), 
+      eof(false), 
+      done(false), 
+      stopping(false)
+{
+    reader = std::thread(&FastxStream::parse, this);
+}
+
+FastxStream::~FastxStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    consumed.notify_all();
+    reader.join();
+}
+
+bool
+FastxStream::next(piece_t& piece)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    produced.wait(lock, [this] { return not queue.empty() or done; });
+    if (queue.empty()) return false;
+    piece = std::move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    consumed.notify_one();
+    return true;
+}
+
+void
+FastxStream::parse()
+{
+    // same record boundaries as kseq: sequence lines end at '>', '+' or '@', qualities are skipped by length
+    int c;
+    while ((c = peek()) >= 0 and not stopping) {
+        if (c != '>' and c != '@') {
+            skip_line(); // anything before the first header
+            continue;
+        }
+        skip_line();
+        current.data.clear();
+        current.data.reserve(chunk_size);
+        current.carry = 0;
+        current.first = true;
+        std::size_t length = 0;
+        while ((c = peek()) >= 0 and c != '>' and c != '+' and c != '@') length += append_line();
+        emit(true);
+        if (c == '+') {
+            skip_line();
+            skip_qualities(length);
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    produced.notify_all();
+}
+
+bool
+FastxStream::fill()
+{
+    if (begin < input.size()) return true;
+    if (eof) return false;
+    constexpr std::size_t block = std::size_t(1) << 20;
+    input.resize(block);
+    const int n = gzread(fp, &input[0], block);
+    if (n <= 0) {
+        eof = true;
+        input.clear();
+        begin = 0;
+        return false;
+    }
+    input.resize(n);
+    begin = 0;
+    return true;
+}
+
+int
+FastxStream::peek()
+{
+    if (not fill()) return -1;
+    return static_cast<unsigned char>(input[begin]);
+}
+
+void
+FastxStream::skip_line()
+{
+    while (fill()) {
+        auto const* nl = static_cast<char const*>(std::memchr(input.data() + begin, '\n', input.size() - begin));
+        if (nl) {
+            begin = nl - input.data() + 1;
+            return;
+        }
+        begin = input.size();
+    }
+}
+
+std::size_t
+FastxStream::append_line()
+{
+    std::size_t length = 0;
+    while (fill()) {
+        auto const* start = input.data() + begin;
+        auto const* nl = static_cast<char const*>(std::memchr(start, '\n', input.size() - begin));
+        std::size_t n = (nl ? nl : input.data() + input.size()) - start;
+        begin += n + (nl ? 1 : 0);
+        length += n;
+        while (n) { // cut full pieces only when more bases arrive, trailing '\r' is dropped first
+            if (current.data.size() == chunk_size) emit(false);
+            const std::size_t take = std::min(n, chunk_size - current.data.size());
+            current.data.append(start, take);
+            start += take;
+            n -= take;
+        }
+        if (nl) break;
+    }
+    if (not current.data.empty() and current.data.back() == '\r') {
+        current.data.pop_back();
+        --length;
+    }
+    return length;
+}
+
+std::size_t
+FastxStream::skip_qualities(std::size_t length)
+{
+    std::size_t seen = 0;
+    while (seen < length and fill()) {
+        auto const* start = input.data() + begin;
+        auto const* nl = static_cast<char const*>(std::memchr(start, '\n', input.size() - begin));
+        const std::size_t n = (nl ? nl : input.data() + input.size()) - start;
+        begin += n + (nl ? 1 : 0);
+        seen += n;
+    }
+    return seen;
+}
+
+void
+FastxStream::emit(const bool last)
+{
+    piece_t piece;
+    piece.carry = 0;
+    piece.first = false;
+    if (not last) { // the next piece starts with the tail of this one
+        const std::size_t carry = std::min(overlap, current.data.size());
+        piece.data.reserve(chunk_size);
+        piece.data.assign(current.data, current.data.size() - carry, carry);
+        piece.carry = carry;
+    }
+    current.last = last;
+    std::swap(current, piece);
+    push(std::move(piece));
+}
+
+void
+FastxStream::push(piece_t&& piece)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    consumed.wait(lock, [this] { return queue.size() < max_queued or stopping; });
+    if (stopping) return;
+    queue.push_back(std::move(piece));
+    lock.unlock();
+    produced.notify_one();
+}
+
+} // namespace sketching
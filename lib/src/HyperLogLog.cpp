@@ -2,23 +2,164 @@
 #include <cmath>
 #include <cassert>
 #include "../include/HyperLogLog.hpp"
+#include "../include/KmerHasher.hpp"
+#include "../include/MultiLaneNtHash.hpp"
+#include "../include/Kernels.hpp"
+#include "../include/AbundanceFilter.hpp"
+#include "../include/SpectrumSketch.hpp"
 #include "../nthash/nthash.hpp"
 
 #include <iostream>
 #include <limits>
+#include <array>
+#include <algorithm>
+#include <optional>
 
 #define BITS_IN_BYTE 8
+#define FORMAT_MAGIC 0xFF // never a valid k, distinguishes tagged sketches from legacy ones
 
 namespace sketching {
 
+namespace {
+
+// Poisson model of a register fed by a set of cardinality m * mu, ranks in [0, q+1]
+double log_register_cdf(const std::size_t r, const double mu, const std::size_t q) noexcept
+{
+    if (r > q) return 0;
+    return -std::ldexp(mu, -static_cast<int>(r));
+}
+
+double log_register_pmf(const std::size_t r, const double mu, const std::size_t q) noexcept
+{
+    if (r == 0) return -mu;
+    const double x = std::ldexp(mu, -static_cast<int>(std::min(r, q)));
+    if (r > q) return std::log(-std::expm1(-x));
+    return -x + std::log(-std::expm1(-x));
+}
+
+double log_sum_exp(const double a, const double b) noexcept
+{
+    if (a == -std::numeric_limits<double>::infinity()) return b;
+    if (b == -std::numeric_limits<double>::infinity()) return a;
+    const double hi = std::max(a, b);
+    return hi + std::log1p(std::exp(std::min(a, b) - hi));
+}
+
+// Nelder-Mead minimization over a 3-dimensional parameter space
+template <typename Function>
+std::array<double, 3> nelder_mead(Function fn, std::array<double, 3> start, const double step)
+{
+    using point_t = std::array<double, 3>;
+    std::array<point_t, 4> simplex;
+    std::array<double, 4> values;
+    for (std::size_t i = 0; i < simplex.size(); ++i) {
+        simplex[i] = start;
+        if (i > 0) simplex[i][i - 1] += step;
+        values[i] = fn(simplex[i]);
+    }
+    auto along = [](point_t const& from, point_t const& to, const double t) {
+        point_t p;
+        for (std::size_t j = 0; j < p.size(); ++j) p[j] = from[j] + t * (to[j] - from[j]);
+        return p;
+    };
+    for (std::size_t iteration = 0; iteration < 2000; ++iteration) {
+        std::array<std::size_t, 4> order = {0, 1, 2, 3};
+        std::sort(order.begin(), order.end(), [&](std::size_t i, std::size_t j) { return values[i] < values[j]; });
+        auto& best = order[0];
+        auto& worst = order[3];
+        if (std::abs(values[worst] - values[best]) <= 1e-10 * (1 + std::abs(values[best]))) break;
+        point_t centroid = {0, 0, 0};
+        for (std::size_t i = 0; i < 3; ++i) {
+            for (std::size_t j = 0; j < centroid.size(); ++j) centroid[j] += simplex[order[i]][j] / 3;
+        }
+        const point_t reflected = along(centroid, simplex[worst], -1);
+        const double fr = fn(reflected);
+        if (fr < values[best]) {
+            const point_t expanded = along(centroid, simplex[worst], -2);
+            const double fe = fn(expanded);
+            if (fe < fr) {
+                simplex[worst] = expanded;
+                values[worst] = fe;
+            } else {
+                simplex[worst] = reflected;
+                values[worst] = fr;
+            }
+        } else if (fr < values[order[2]]) {
+            simplex[worst] = reflected;
+            values[worst] = fr;
+        } else {
+            const point_t contracted = along(centroid, simplex[worst], 0.5);
+            const double fc = fn(contracted);
+            if (fc < values[worst]) {
+                simplex[worst] = contracted;
+                values[worst] = fc;
+            } else { // shrink towards the best point
+                for (std::size_t i = 1; i < order.size(); ++i) {
+                    simplex[order[i]] = along(simplex[best], simplex[order[i]], 0.5);
+                    values[order[i]] = fn(simplex[order[i]]);
+                }
+            }
+        }
+    }
+    return simplex[std::min_element(values.begin(), values.end()) - values.begin()];
+}
+
+// hashers and buffers reused across add() calls, steady-state batches do not allocate
+struct add_scratch_t {
+    std::vector<std::string_view> lane_batch;
+    std::optional<MultiLaneNtHash> lanes;
+    std::vector<std::string> seeds;
+    std::optional<nthash::SeedNtHash> seeded;
+};
+
+add_scratch_t& thread_scratch()
+{
+    thread_local add_scratch_t scratch;
+    return scratch;
+}
+
+} // namespace
+
+HashBackend
+hash_backend_from_string(std::string const& name)
+{
+    if (name == "nthash") return HashBackend::nthash;
+    if (name == "packed") return HashBackend::packed;
+    throw std::invalid_argument("unknown hash backend " + name + " (nthash, packed)");
+}
+
+std::string
+to_string(const HashBackend backend)
+{
+    switch (backend) {
+        case HashBackend::nthash: return "nthash";
+        case HashBackend::packed: return "packed";
+    }
+    return "unknown";
+}
+
+double
+JointEstimate::jaccard() const noexcept
+{
+    const double total = intersection + only_left + only_right;
+    return total > 0 ? intersection / total : 0;
+}
+
+double
+JointEstimate::containment() const noexcept
+{
+    const double left = intersection + only_left;
+    return left > 0 ? intersection / left : 0;
+}
+
 HyperLogLog::HyperLogLog() 
-    : k(0), b(0), shift(0), mask(0), total_seen_kmers(0)
+    : k(0), b(0), backend(HashBackend::nthash), total_seen_kmers(0)
 {
     sanitize_endianness();
 }
 
-HyperLogLog::HyperLogLog(const uint8_t kmer_length, const double error_rate)
-    : k(kmer_length), total_seen_kmers(0)
+HyperLogLog::HyperLogLog(const uint8_t kmer_length, const double error_rate, const HashBackend hash_backend)
+    : k(kmer_length), backend(hash_backend), total_seen_kmers(0)
 {
     if (error_rate < 0 or error_rate > 1) throw std::invalid_argument("error rate should be in (0, 1)");
     auto x = double(1.04) / error_rate;
@@ -28,25 +169,38 @@ HyperLogLog::HyperLogLog(const uint8_t kmer_length, const double error_rate)
     sanitize_endianness();
     sanitize_kmer_length(k);
     sanitize_b(b);
-    init();
-    clear();
+    sanitize_backend();
+    init(); // fresh registers are zero
 }
 
-HyperLogLog::HyperLogLog(const uint8_t kmer_length, const uint8_t msb_length)
-    : k(kmer_length), b(msb_length), total_seen_kmers(0)
+HyperLogLog::HyperLogLog(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend)
+    : k(kmer_length), b(msb_length), backend(hash_backend), total_seen_kmers(0)
 {
     sanitize_endianness();
     sanitize_kmer_length(k);
     sanitize_b(b);
-    init();
-    clear();
+    sanitize_backend();
+    init(); // fresh registers are zero
+}
+
+HyperLogLog::HyperLogLog(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend, uint8_t const * const regs, const std::size_t total_kmers)
+    : HyperLogLog(kmer_length, msb_length, hash_backend)
+{
+    std::copy(regs, regs + registers.size(), registers.begin());
+    total_seen_kmers = total_kmers;
 }
 
 HyperLogLog::HyperLogLog(std::istream& istrm)
 {
-    // load k, b;
+    // load [magic, backend,] k, b; legacy sketches start directly with k and use ntHash
+    backend = HashBackend::nthash;
     istrm.read(reinterpret_cast<char*>(&k), sizeof(k));
+    if (k == FORMAT_MAGIC) {
+        istrm.read(reinterpret_cast<char*>(&backend), sizeof(backend));
+        istrm.read(reinterpret_cast<char*>(&k), sizeof(k));
+    }
     sanitize_kmer_length(k);
+    sanitize_backend();
     istrm.read(reinterpret_cast<char*>(&b), sizeof(b));
     sanitize_b(b);
     istrm.read(reinterpret_cast<char*>(&total_seen_kmers), sizeof(total_seen_kmers)); // TODO fix endianess
@@ -55,32 +209,110 @@ HyperLogLog::HyperLogLog(std::istream& istrm)
     istrm.read(reinterpret_cast<char*>(&registers[0]), registers.size()); // uint8_t so no need to endianess nor sizeof
 }
 
+inline void
+HyperLogLog::update(const hash_t hval) noexcept
+{
+    ++total_seen_kmers;
+    uint64_t const* words = reinterpret_cast<uint64_t const*>(&hval);
+    if (kmer_filter and not kmer_filter->keep(words[0], words[1])) return;
+    if (spectrum) spectrum->add(words[0]);
+    if (abundance_filter and not abundance_filter->admit(words[0], words[1])) return;
+    const auto [idx, v] = register_and_rank(words[0], words[1], b);
+    assert(v < BITS_IN_BYTE * sizeof(hash_t));
+    if (v > registers.at(idx)) registers[idx] = v;
+}
+
 void
 HyperLogLog::add(char const * const seq, const std::size_t length) noexcept
 {
-    nthash::NtHash hasher(
-        seq, 
-        length, 
-        std::max(static_cast<std::size_t>(sizeof(hash_t) / sizeof(uint64_t)), static_cast<std::size_t>(1)), 
-        k, 
-        0
-    );
+    for_each_kmer_hash(seq, length, k, backend, [this](const uint64_t h0, const uint64_t h1) noexcept {
+        update((static_cast<hash_t>(h1) << 64) | h0);
+    });
+}
+
+void
+HyperLogLog::add(std::vector<std::string_view> const& batch)
+{
+    // short reads go through the SIMD lanes together, long ones would leave the other lanes idle
+    constexpr std::size_t long_sequence = 1 << 16;
+    auto& scratch = thread_scratch();
+    auto& lane_batch = scratch.lane_batch;
+    lane_batch.clear();
+    for (auto const& s : batch) {
+        if (s.size() < k) continue;
+        if (backend == HashBackend::nthash and s.size() < long_sequence) lane_batch.push_back(s);
+        else add(s.data(), s.size());
+    }
+    if (lane_batch.empty()) return;
+    if (not scratch.lanes) scratch.lanes.emplace(k);
+    else if (scratch.lanes->get_k() != k) scratch.lanes->reset(k);
+    scratch.lanes->hash(lane_batch, [this](uint64_t const* hashes, std::size_t nkmers) {
+        if (kmer_filter or abundance_filter or spectrum) {
+            for (std::size_t i = 0; i < nkmers; ++i) update(*reinterpret_cast<hash_t const*>(hashes + 2 * i));
+            return;
+        }
+        kernels::update_registers(registers.data(), hashes, nkmers, b);
+        total_seen_kmers += nkmers;
+    });
+}
+
+void
+HyperLogLog::add(std::vector<HyperLogLog>& sketches, std::vector<std::string> const& seeds, char const * const seq, const std::size_t length)
+{
+    // one rolling pass over the sequence for all seeds, seed i feeds sketch i
+    if (sketches.size() != seeds.size()) throw std::invalid_argument("[add] Number of sketches and spaced seeds differ");
+    if (sketches.empty()) return;
+    const auto k = sketches.front().k;
+    for (std::size_t i = 0; i < seeds.size(); ++i) {
+        if (sketches[i].k != k or seeds[i].size() != k) throw std::invalid_argument("[add] Spaced seeds must be as long as the k-mers");
+        if (sketches[i].backend != HashBackend::nthash) throw std::invalid_argument("[add] Spaced seeds are only supported by the ntHash backend");
+    }
+    if (length < k) return;
+    const std::size_t hashes_per_seed = std::max(static_cast<std::size_t>(sizeof(hash_t) / sizeof(uint64_t)), static_cast<std::size_t>(1));
+    auto& scratch = thread_scratch();
+    if (not scratch.seeded or scratch.seeds != seeds) {
+        scratch.seeded.emplace(seq, length, seeds, hashes_per_seed, k, 0);
+        scratch.seeds = seeds;
+    } else {
+        scratch.seeded->change_seq(seq, length);
+    }
+    auto& hasher = *scratch.seeded;
     while(hasher.roll()) {
-        hash_t hval = *reinterpret_cast<hash_t const*>(hasher.hashes());
-        const auto idx = hval >> shift;
-        const auto lsb = hval & mask;
-        const std::size_t v = clz(lsb) + 1 - b;
-        assert(v < BITS_IN_BYTE * sizeof(hash_t));
-        assert(v < std::numeric_limits<register_t>::max()); // v must fit into registers
-        if (v > registers.at(idx)) registers[idx] = v;
-        ++total_seen_kmers;
+        for (std::size_t i = 0; i < sketches.size(); ++i) {
+            sketches[i].update(*reinterpret_cast<hash_t const*>(hasher.hashes() + i * hashes_per_seed));
+        }
     }
 }
 
 void 
 HyperLogLog::clear() noexcept
 {
-    for (auto& r : registers) r = 0;
+    memory::zero(registers.data(), registers.size());
+}
+
+void
+HyperLogLog::reset() noexcept
+{
+    clear();
+    total_seen_kmers = 0;
+}
+
+void
+HyperLogLog::set_abundance_filter(std::shared_ptr<AbundanceFilter> filter) noexcept
+{
+    abundance_filter = std::move(filter);
+}
+
+void
+HyperLogLog::set_spectrum(std::shared_ptr<SpectrumSketch> spectrum_sketch) noexcept
+{
+    spectrum = std::move(spectrum_sketch);
+}
+
+void
+HyperLogLog::set_kmer_filter(std::shared_ptr<KmerFilter> filter) noexcept
+{
+    kmer_filter = std::move(filter);
 }
 
 std::size_t
@@ -89,13 +321,24 @@ HyperLogLog::size() const noexcept
     return total_seen_kmers;
 }
 
+HashBackend
+HyperLogLog::hash_backend() const noexcept
+{
+    return backend;
+}
+
+uint8_t
+HyperLogLog::msb_length() const noexcept
+{
+    return b;
+}
+
 std::size_t
 HyperLogLog::count() const noexcept
 {
-    // !!! DO NOT compute registers.size()**2 first because if b >= 32 we have an integer overflow
-    auto hmean = harmonic_mean();
-    const std::size_t raw_estimate = (alpha_m * hmean * registers.size()) * registers.size(); // !!!
-    return static_cast<std::size_t>(bias_correction(raw_estimate));
+    return estimate(kernels::inverse_power_sum(registers.data(), registers.size()), registers.size(), [this] {
+        return kernels::count_zeros(registers.data(), registers.size());
+    });
 }
 
 double
@@ -104,14 +347,138 @@ HyperLogLog::standard_error() const noexcept
     return static_cast<double>(1.04) / sqrt(registers.size());
 }
 
+JointEstimate
+HyperLogLog::joint_estimate(const HyperLogLog& other) const
+{
+    // Ertl, "New cardinality estimation algorithms for HyperLogLog sketches", joint estimation.
+    if (k != other.k) throw std::runtime_error("[joint_estimate] Comparing sketches of different k-mer lengths");
+    if (b > other.b) return fold(other.b).joint_estimate(other);
+    if (b < other.b) return joint_estimate(other.fold(b));
+    if (not compatible(other)) throw std::runtime_error("[joint_estimate] Comparing incompatible sketches");
+    const std::size_t q = BITS_IN_BYTE * sizeof(hash_t) - b;
+    std::vector<std::size_t> left_lt(q + 2), left_gt(q + 2), right_lt(q + 2), right_gt(q + 2), equal(q + 2);
+    for (std::size_t i = 0; i < registers.size(); ++i) {
+        const std::size_t r1 = std::min(static_cast<std::size_t>(registers[i]), q + 1);
+        const std::size_t r2 = std::min(static_cast<std::size_t>(other.registers[i]), q + 1);
+        if (r1 < r2) {
+            ++left_lt[r1];
+            ++right_gt[r2];
+        } else if (r1 > r2) {
+            ++left_gt[r1];
+            ++right_lt[r2];
+        } else {
+            ++equal[r1];
+        }
+    }
+
+    // inclusion-exclusion over the marginal histograms as starting point
+    std::vector<std::size_t> left(q + 2), right(q + 2), both(q + 2);
+    for (std::size_t r = 0; r < q + 2; ++r) {
+        left[r] = left_lt[r] + left_gt[r] + equal[r];
+        right[r] = right_lt[r] + right_gt[r] + equal[r];
+        both[r] = left_gt[r] + right_gt[r] + equal[r];
+    }
+    const double card_left = histogram_estimate(left);
+    const double card_right = histogram_estimate(right);
+    const double card_union = histogram_estimate(both);
+    const double x0 = std::max(card_left + card_right - card_union, 1.0);
+    const double a0 = std::max(card_left - x0, 1.0);
+    const double b0 = std::max(card_right - x0, 1.0);
+
+    const double m = static_cast<double>(registers.size());
+    auto negative_log_likelihood = [&](std::array<double, 3> const& theta) {
+        const double mu_a = std::exp(theta[0]) / m;
+        const double mu_b = std::exp(theta[1]) / m;
+        const double mu_x = std::exp(theta[2]) / m;
+        double ll = 0;
+        for (std::size_t r = 0; r < q + 2; ++r) {
+            if (left_lt[r]) ll += left_lt[r] * log_register_pmf(r, mu_a + mu_x, q);
+            if (right_gt[r]) ll += right_gt[r] * log_register_pmf(r, mu_b, q);
+            if (left_gt[r]) ll += left_gt[r] * log_register_pmf(r, mu_a, q);
+            if (right_lt[r]) ll += right_lt[r] * log_register_pmf(r, mu_b + mu_x, q);
+            if (equal[r]) {
+                const double shared = log_register_pmf(r, mu_x, q) + log_register_cdf(r, mu_a, q) + log_register_cdf(r, mu_b, q);
+                const double separate = r == 0 ? 
+                    -std::numeric_limits<double>::infinity() : 
+                    log_register_cdf(r - 1, mu_x, q) + log_register_pmf(r, mu_a, q) + log_register_pmf(r, mu_b, q);
+                ll += equal[r] * log_sum_exp(shared, separate);
+            }
+        }
+        return std::isnan(ll) ? std::numeric_limits<double>::infinity() : -ll;
+    };
+    const auto theta = nelder_mead(negative_log_likelihood, {std::log(a0), std::log(b0), std::log(x0)}, 0.5);
+    JointEstimate result;
+    result.only_left = std::exp(theta[0]);
+    result.only_right = std::exp(theta[1]);
+    result.intersection = std::exp(theta[2]);
+    return result;
+}
+
+JointEstimate
+HyperLogLog::inclusion_exclusion(const HyperLogLog& other, std::size_t nregisters) const
+{
+    // Cheap single-pass estimate, optionally on the first nregisters only (a uniform sample of the hash space).
+    if (k != other.k) throw std::runtime_error("[inclusion_exclusion] Comparing sketches of different k-mer lengths");
+    if (b > other.b) return fold(other.b).inclusion_exclusion(other, nregisters);
+    if (b < other.b) return inclusion_exclusion(other.fold(b), nregisters);
+    if (not compatible(other)) throw std::runtime_error("[inclusion_exclusion] Comparing incompatible sketches");
+    if (nregisters == 0 or nregisters > registers.size()) nregisters = registers.size();
+    const std::size_t q = BITS_IN_BYTE * sizeof(hash_t) - b;
+    std::vector<std::size_t> left(q + 2), right(q + 2), both(q + 2);
+    constexpr std::size_t chunk_size = 256;
+    std::array<register_t, chunk_size> chunk;
+    for (std::size_t i = 0; i < nregisters; i += chunk_size) {
+        const std::size_t len = std::min(chunk_size, nregisters - i);
+        register_t const* lregs = registers.data() + i;
+        register_t const* rregs = other.registers.data() + i;
+        for (std::size_t j = 0; j < len; ++j) chunk[j] = std::max(lregs[j], rregs[j]); // vectorized
+        for (std::size_t j = 0; j < len; ++j) {
+            ++left[std::min(static_cast<std::size_t>(lregs[j]), q + 1)];
+            ++right[std::min(static_cast<std::size_t>(rregs[j]), q + 1)];
+            ++both[std::min(static_cast<std::size_t>(chunk[j]), q + 1)];
+        }
+    }
+    const double scale = static_cast<double>(registers.size()) / nregisters;
+    const double card_left = scale * histogram_estimate(left);
+    const double card_right = scale * histogram_estimate(right);
+    const double card_union = scale * histogram_estimate(both);
+    JointEstimate result;
+    result.intersection = std::max(card_left + card_right - card_union, 0.0);
+    result.only_left = std::max(card_union - card_right, 0.0);
+    result.only_right = std::max(card_union - card_left, 0.0);
+    return result;
+}
+
 HyperLogLog
-HyperLogLog::operator+(const HyperLogLog& other) const
+HyperLogLog::fold(const uint8_t msb_length) const
 {
-    if (not compatible(other)) throw std::runtime_error("[operator+] Adding two incompatible sketches");
-    HyperLogLog toRet(k, b);
+    if (msb_length > b) throw std::invalid_argument("[fold] Cannot increase the precision of a sketch");
+    if (msb_length == b) return *this;
+    HyperLogLog toRet(k, msb_length, backend);
+    const std::size_t d = b - msb_length;
+    const std::size_t low_mask = (std::size_t(1) << d) - 1;
     for (std::size_t i = 0; i < registers.size(); ++i) {
-        toRet.registers[i] = std::max(registers.at(i), other.registers.at(i));
+        if (registers[i] == 0) continue;
+        // the d dropped index bits become the leading bits of the longer suffix
+        const std::size_t low = i & low_mask;
+        const std::size_t v = low ? d - (BITS_IN_BYTE * sizeof(uint64_t) - 1 - __builtin_clzll(low)) : registers[i] + d;
+        auto& r = toRet.registers[i >> d];
+        if (v > r) r = v;
     }
+    toRet.total_seen_kmers = total_seen_kmers;
+    return toRet;
+}
+
+HyperLogLog
+HyperLogLog::operator+(const HyperLogLog& other) const
+{
+    if (k != other.k) throw std::runtime_error("[operator+] Adding sketches of different k-mer lengths");
+    if (b > other.b) return fold(other.b) + other;
+    if (b < other.b) return *this + other.fold(b);
+    if (not compatible(other)) throw std::runtime_error("[operator+] Adding two incompatible sketches");
+    HyperLogLog toRet(k, b, backend);
+    toRet.registers = registers;
+    kernels::merge_max(toRet.registers.data(), other.registers.data(), toRet.registers.size());
     toRet.total_seen_kmers = total_seen_kmers + other.total_seen_kmers;
     return toRet;
 }
@@ -119,10 +486,11 @@ HyperLogLog::operator+(const HyperLogLog& other) const
 HyperLogLog& 
 HyperLogLog::operator+=(const HyperLogLog& other)
 {
+    if (k != other.k) throw std::runtime_error("[operator+=] Merging sketches of different k-mer lengths");
+    if (b > other.b) *this = fold(other.b);
+    if (b < other.b) return *this += other.fold(b);
     if (not compatible(other)) throw std::runtime_error("[operator+=] Merging incompatible sketches");
-    for (std::size_t i = 0; i < registers.size(); ++i) {
-        registers[i] = std::max(registers.at(i), other.registers.at(i));
-    }
+    kernels::merge_max(registers.data(), other.registers.data(), registers.size());
     total_seen_kmers += other.total_seen_kmers;
     return *this;
 }
@@ -130,7 +498,10 @@ HyperLogLog::operator+=(const HyperLogLog& other)
 void 
 HyperLogLog::store(std::ostream& ostrm) const
 {
-    // save k, b, total_seen_kmers;
+    // save magic, backend, k, b, total_seen_kmers;
+    const uint8_t magic = FORMAT_MAGIC;
+    ostrm.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    ostrm.write(reinterpret_cast<const char*>(&backend), sizeof(backend));
     ostrm.write(reinterpret_cast<const char*>(&k), sizeof(k));
     ostrm.write(reinterpret_cast<const char*>(&b), sizeof(b));
     ostrm.write(reinterpret_cast<const char*>(&total_seen_kmers), sizeof(total_seen_kmers));
@@ -150,13 +521,25 @@ HyperLogLog::load(std::string const& sketch_filename) {
     return HyperLogLog(istrm);
 }
 
+uint8_t
+HyperLogLog::load_msb_length(std::string const& sketch_filename)
+{
+    // [magic, backend,] k, b as in HyperLogLog(std::istream&)
+    std::ifstream istrm(sketch_filename, std::ios::binary);
+    uint8_t header[4];
+    istrm.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (not istrm) throw std::runtime_error("[load_msb_length] Unable to read the header of " + sketch_filename);
+    const uint8_t bval = header[0] == FORMAT_MAGIC ? header[3] : header[1];
+    sanitize_b(bval);
+    return bval;
+}
+
 void
 HyperLogLog::init()
 {
-    registers.resize(static_cast<hash_t>(1) << b);
-    alpha_m = 0.7213 / (1 + 1.079 / registers.size());
-    shift = (BITS_IN_BYTE * sizeof(hash_t) - b);
-    mask = (static_cast<hash_t>(1) << shift) - 1;
+    const std::size_t m = static_cast<std::size_t>(1) << b;
+    memory::check_budget(m * sizeof(register_t)); // before touching any memory
+    registers.resize(m);
 }
 
 void
@@ -176,66 +559,42 @@ HyperLogLog::sanitize_kmer_length(const std::size_t kmer_length) const
 }
 
 void 
-HyperLogLog::sanitize_b(const std::size_t bval) const 
+HyperLogLog::sanitize_b(const std::size_t bval)
 {
     const std::size_t pack_shift = BITS_IN_BYTE * (sizeof(uint64_t) - sizeof(register_t));
-    if (bval >= pack_shift) throw std::invalid_argument(std::string("Number of indexing bits should be < ") + std::to_string(pack_shift));
+    if (bval == 0 or bval >= pack_shift) throw std::invalid_argument(std::string("Number of indexing bits should be in [1, ") + std::to_string(pack_shift) + ")");
+}
+
+void
+HyperLogLog::sanitize_backend() const
+{
+    if (backend != HashBackend::nthash and backend != HashBackend::packed) throw std::invalid_argument("Unknown hash backend");
+    if (backend == HashBackend::packed and k > BITS_IN_BYTE * sizeof(uint64_t) / 2) throw std::invalid_argument("The packed hash backend requires k <= 32");
 }
 
 bool 
 HyperLogLog::compatible(const HyperLogLog& other) const noexcept
 {
     bool same_k = k == other.k;
+    bool same_backend = backend == other.backend;
     bool same_b = b == other.b;
     bool same_size = registers.size() == other.registers.size();
-    return same_k and same_b and same_size;
-}
-
-double 
-HyperLogLog::harmonic_mean() const noexcept
-{
-    double sum_of_inverses = 0;
-    for (auto r : registers) {
-        auto toadd = 1.0 / (static_cast<hash_t>(1) << r);
-        sum_of_inverses += toadd;
-    }
-    return 1.0 / sum_of_inverses;
+    return same_k and same_b and same_backend and same_size;
 }
 
 double
-HyperLogLog::bias_correction(const double raw_estimate) const noexcept
+HyperLogLog::histogram_estimate(std::vector<std::size_t> const& histogram) noexcept
 {
-    if (raw_estimate <= 2.5 * registers.size()) { // linear counting
-        std::size_t count = 0;
-        for (auto r : registers) if (r == 0) ++count;
-        if (count != 0) return registers.size() * std::log(static_cast<double>(registers.size()) / count);
-    }
-    if constexpr (sizeof(hash_t) == sizeof(uint32_t)) {
-        if (raw_estimate > (static_cast<hash_t>(1) << 32) / 30) { // large range correction
-            return -std::pow(2, 32) * std::log(1 - raw_estimate / std::pow(2, 32));
-        }
+    double m = 0;
+    double sum_of_inverses = 0;
+    for (std::size_t r = 0; r < histogram.size(); ++r) {
+        m += histogram[r];
+        sum_of_inverses += std::ldexp(static_cast<double>(histogram[r]), -static_cast<int>(r));
     }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    const double raw_estimate = (alpha / sum_of_inverses * m) * m;
+    if (raw_estimate <= 2.5 * m and histogram[0] != 0) return m * std::log(m / histogram[0]);
     return raw_estimate;
 }
 
-int 
-HyperLogLog::clz(const uint32_t x) const noexcept
-{
-    return x ? __builtin_clz(x) : (BITS_IN_BYTE * sizeof(sketching::HyperLogLog::hash_t));
-}
-
-int 
-HyperLogLog::clz(const uint64_t x) const noexcept
-{
-    return x ? __builtin_clzll(x) : (BITS_IN_BYTE * sizeof(sketching::HyperLogLog::hash_t));
-}
-
-int 
-HyperLogLog::clz(const __uint128_t x) const noexcept
-{
-    uint64_t const* view = reinterpret_cast<uint64_t const*>(&x);
-    if (view[1] == 0) return 64 + clz(view[0]);
-    return clz(view[1]);
-}
-
 } // namespace sketching
@@ -0,0 +1,249 @@
+#include "../include/Kernels.hpp"
+#include "../include/MultiLaneNtHash.hpp"
+#include <cstring>
+#include <sstream>
+
+namespace sketching {
+
+namespace cpu {
+
+features_t const& features() noexcept
+{
+    static const features_t detected = [] {
+        features_t f = {false, false, false, false, false};
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        f.lzcnt = __builtin_cpu_supports("abm");
+        f.bmi2 = __builtin_cpu_supports("bmi2");
+        f.avx2 = __builtin_cpu_supports("avx2");
+        f.avx512f = __builtin_cpu_supports("avx512f");
+        f.avx512bw = __builtin_cpu_supports("avx512bw");
+#endif
+        return f;
+    }();
+    return detected;
+}
+
+} // namespace cpu
+
+namespace {
+
+typedef uint8_t bytes_t __attribute__((vector_size(64)));
+typedef uint8_t byte8_t __attribute__((vector_size(8)));
+typedef uint64_t words_t __attribute__((vector_size(64)));
+typedef double doubles_t __attribute__((vector_size(64)));
+
+__attribute__((always_inline)) inline void 
+update_body(uint8_t* registers, uint64_t const* hashes, const std::size_t n, const uint8_t b) noexcept
+{
+    // same rank as HyperLogLog::update: clz of the hash without its b index bits, + 1 - b
+    for (std::size_t i = 0; i < n; ++i) {
+        const uint64_t lo = hashes[2 * i];
+        const uint64_t hi = hashes[2 * i + 1];
+        const std::size_t idx = b ? hi >> (64 - b) : 0;
+        const uint64_t lsb_hi = (hi << b) >> b;
+        const unsigned lz = lsb_hi ? __builtin_clzll(lsb_hi) : 64 + (lo ? __builtin_clzll(lo) : 128);
+        const uint8_t v = lz + 1 - b;
+        if (v > registers[idx]) registers[idx] = v;
+    }
+}
+
+__attribute__((always_inline)) inline void 
+merge_body(uint8_t* dst, uint8_t const* src, const std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    for (; i + sizeof(bytes_t) <= n; i += sizeof(bytes_t)) {
+        bytes_t x, y;
+        std::memcpy(&x, dst + i, sizeof(x));
+        std::memcpy(&y, src + i, sizeof(y));
+        x = x > y ? x : y;
+        std::memcpy(dst + i, &x, sizeof(x));
+    }
+    for (; i < n; ++i) if (src[i] > dst[i]) dst[i] = src[i];
+}
+
+__attribute__((always_inline)) inline double 
+inverse_power_sum_body(uint8_t const* registers, const std::size_t n) noexcept
+{
+    // 2^-r built from its exponent bits, lane j sums the registers i = j mod 8
+    doubles_t partial = {};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        byte8_t r;
+        std::memcpy(&r, registers + i, sizeof(r));
+        const words_t bits = (1023 - __builtin_convertvector(r, words_t)) << 52;
+        doubles_t terms;
+        std::memcpy(&terms, &bits, sizeof(terms));
+        partial += terms;
+    }
+    double sum = ((partial[0] + partial[1]) + (partial[2] + partial[3])) + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+    for (; i < n; ++i) {
+        const uint64_t bits = (1023 - static_cast<uint64_t>(registers[i])) << 52;
+        double term;
+        std::memcpy(&term, &bits, sizeof(term));
+        sum += term;
+    }
+    return sum;
+}
+
+__attribute__((always_inline)) inline std::size_t 
+count_zeros_body(uint8_t const* registers, const std::size_t n) noexcept
+{
+    std::size_t count = 0;
+    std::size_t i = 0;
+    while (i + sizeof(bytes_t) <= n) {
+        bytes_t partial = {}; // byte counters, flushed before they can overflow
+        for (std::size_t j = 0; j < 255 and i + sizeof(bytes_t) <= n; ++j, i += sizeof(bytes_t)) {
+            bytes_t x;
+            std::memcpy(&x, registers + i, sizeof(x));
+            partial -= (x == 0);
+        }
+        for (std::size_t j = 0; j < sizeof(bytes_t); ++j) count += partial[j];
+    }
+    for (; i < n; ++i) count += registers[i] == 0;
+    return count;
+}
+
+void update_generic(uint8_t* registers, uint64_t const* hashes, const std::size_t n, const uint8_t b) noexcept
+{
+    update_body(registers, hashes, n, b);
+}
+
+void merge_generic(uint8_t* dst, uint8_t const* src, const std::size_t n) noexcept
+{
+    merge_body(dst, src, n);
+}
+
+double inverse_power_sum_generic(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return inverse_power_sum_body(registers, n);
+}
+
+std::size_t count_zeros_generic(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return count_zeros_body(registers, n);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("lzcnt,bmi2"))) void 
+update_lzcnt(uint8_t* registers, uint64_t const* hashes, const std::size_t n, const uint8_t b) noexcept
+{
+    update_body(registers, hashes, n, b);
+}
+
+__attribute__((target("avx2"))) void 
+merge_avx2(uint8_t* dst, uint8_t const* src, const std::size_t n) noexcept
+{
+    merge_body(dst, src, n);
+}
+
+__attribute__((target("avx512f,avx512bw"))) void 
+merge_avx512(uint8_t* dst, uint8_t const* src, const std::size_t n) noexcept
+{
+    merge_body(dst, src, n);
+}
+
+__attribute__((target("avx2"))) double 
+inverse_power_sum_avx2(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return inverse_power_sum_body(registers, n);
+}
+
+__attribute__((target("avx512f"))) double 
+inverse_power_sum_avx512(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return inverse_power_sum_body(registers, n);
+}
+
+__attribute__((target("avx2"))) std::size_t 
+count_zeros_avx2(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return count_zeros_body(registers, n);
+}
+
+__attribute__((target("avx512f,avx512bw"))) std::size_t 
+count_zeros_avx512(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return count_zeros_body(registers, n);
+}
+#endif
+
+struct dispatch_t {
+    void (*update)(uint8_t*, uint64_t const*, const std::size_t, const uint8_t) noexcept;
+    void (*merge)(uint8_t*, uint8_t const*, const std::size_t) noexcept;
+    double (*inverse_power_sum)(uint8_t const*, const std::size_t) noexcept;
+    std::size_t (*count_zeros)(uint8_t const*, const std::size_t) noexcept;
+    char const* update_path;
+    char const* merge_path;
+    char const* estimate_path;
+};
+
+dispatch_t const& dispatch() noexcept
+{
+    static const dispatch_t selected = [] {
+        dispatch_t d = {update_generic, merge_generic, inverse_power_sum_generic, count_zeros_generic, "generic", "generic", "generic"};
+#if defined(__x86_64__)
+        auto const& f = cpu::features();
+        if (f.lzcnt and f.bmi2) {
+            d.update = update_lzcnt;
+            d.update_path = "lzcnt";
+        }
+        if (f.avx512f and f.avx512bw) {
+            d.merge = merge_avx512;
+            d.inverse_power_sum = inverse_power_sum_avx512;
+            d.count_zeros = count_zeros_avx512;
+            d.merge_path = d.estimate_path = "avx512";
+        } else if (f.avx2) {
+            d.merge = merge_avx2;
+            d.inverse_power_sum = inverse_power_sum_avx2;
+            d.count_zeros = count_zeros_avx2;
+            d.merge_path = d.estimate_path = "avx2";
+        }
+#endif
+        return d;
+    }();
+    return selected;
+}
+
+} // namespace
+
+namespace cpu {
+
+std::string dispatch_report()
+{
+    auto const& d = dispatch();
+    std::stringstream ss;
+    ss << "hashing\t" << MultiLaneNtHash::path() << " (" << MultiLaneNtHash::lanes() << " lanes)\n";
+    ss << "register-update\t" << d.update_path << "\n";
+    ss << "merge\t" << d.merge_path << "\n";
+    ss << "estimate\t" << d.estimate_path << "\n";
+    return ss.str();
+}
+
+} // namespace cpu
+
+namespace kernels {
+
+void update_registers(uint8_t* registers, uint64_t const* hashes, const std::size_t n, const uint8_t b) noexcept
+{
+    dispatch().update(registers, hashes, n, b);
+}
+
+void merge_max(uint8_t* dst, uint8_t const* src, const std::size_t n) noexcept
+{
+    dispatch().merge(dst, src, n);
+}
+
+double inverse_power_sum(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return dispatch().inverse_power_sum(registers, n);
+}
+
+std::size_t count_zeros(uint8_t const* registers, const std::size_t n) noexcept
+{
+    return dispatch().count_zeros(registers, n);
+}
+
+} // namespace kernels
+
+} // namespace sketching
@@ -0,0 +1,191 @@
+#include "../include/MultiLaneNtHash.hpp"
+#include "../include/Kernels.hpp"
+#include "../nthash/internal.hpp"
+
+namespace sketching {
+
+namespace {
+
+template <unsigned L>
+struct lane_vector {
+    typedef uint64_t type __attribute__((vector_size(L * sizeof(uint64_t))));
+};
+
+struct lane_t {
+    char const* seq;
+    std::size_t len;
+    std::size_t pos;
+    std::size_t valid; // bases since the last reset
+};
+
+// give the next sequence of at least k bases to the lane, if any
+inline bool refill(lane_t& lane, std::vector<std::string_view> const& batch, std::size_t& next, const uint16_t k) noexcept
+{
+    while (next < batch.size() and batch[next].size() < k) ++next;
+    if (next < batch.size()) {
+        lane = {batch[next].data(), batch[next].size(), 0, 0};
+        ++next;
+        return true;
+    }
+    lane = {nullptr, 0, 0, 0};
+    return false;
+}
+
+/*
+ * Every lane rolls 
+ *      fwd' = srol(fwd) ^ fwd_in[in] ^ fwd_out[out]
+ *      rev' = sror(rev ^ rev_in[in] ^ rev_out[out])
+ * where the out terms are 0 until the window holds k bases, which reproduces base_forward_hash and 
+ * base_reverse_hash while filling and next_*_hash afterwards. The state is zeroed after an N or at 
+ * the end of the lane's sequence.
+ */
+template <unsigned L>
+__attribute__((always_inline)) inline void 
+lanes_kernel(
+    std::vector<std::string_view> const& batch, 
+    const uint16_t k, 
+    const uint64_t multiplier, 
+    MultiLaneNtHash::tables_t const& tab, 
+    uint64_t* buffer, 
+    MultiLaneNtHash::flush_t const& flush)
+{
+    using vec_t = typename lane_vector<L>::type;
+    constexpr uint64_t srol_keep = 0xFFFFFFFDFFFFFFFFULL;
+    constexpr uint64_t sror_keep = 0xFFFFFFFEFFFFFFFFULL;
+    lane_t lanes[L];
+    std::size_t next = 0;
+    unsigned active = 0;
+    for (auto& lane : lanes) if (refill(lane, batch, next, k)) ++active;
+
+    vec_t fwd = {}, rev = {};
+    alignas(64) uint64_t in_f[L], out_f[L], in_r[L], out_r[L], keep[L], canonical[L];
+    bool emit[L];
+    std::size_t nkmers = 0;
+    while (active) {
+        for (unsigned l = 0; l < L; ++l) {
+            lane_t& lane = lanes[l];
+            emit[l] = false;
+            if (lane.seq == nullptr) {
+                in_f[l] = out_f[l] = in_r[l] = out_r[l] = keep[l] = 0;
+                continue;
+            }
+            const auto c = static_cast<unsigned char>(lane.seq[lane.pos]);
+            if (tab.fwd_in[c] == nthash::SEED_N) { // reset on invalid characters
+                in_f[l] = out_f[l] = in_r[l] = out_r[l] = keep[l] = 0;
+                lane.valid = 0;
+            } else {
+                in_f[l] = tab.fwd_in[c];
+                in_r[l] = tab.rev_in[c];
+                if (lane.valid >= k) {
+                    const auto o = static_cast<unsigned char>(lane.seq[lane.pos - k]);
+                    out_f[l] = tab.fwd_out[o];
+                    out_r[l] = tab.rev_out[o];
+                } else {
+                    out_f[l] = out_r[l] = 0;
+                }
+                keep[l] = ~uint64_t(0);
+                emit[l] = ++lane.valid >= k;
+            }
+            if (++lane.pos == lane.len) { // next sequence starts from a clean state
+                keep[l] = 0;
+                if (not refill(lane, batch, next, k)) --active;
+            }
+        }
+        vec_t vin_f, vout_f, vin_r, vout_r, vkeep;
+        __builtin_memcpy(&vin_f, in_f, sizeof(vec_t));
+        __builtin_memcpy(&vout_f, out_f, sizeof(vec_t));
+        __builtin_memcpy(&vin_r, in_r, sizeof(vec_t));
+        __builtin_memcpy(&vout_r, out_r, sizeof(vec_t));
+        __builtin_memcpy(&vkeep, keep, sizeof(vec_t));
+        // srol: split rotation of the 33 and 31 bit halves
+        vec_t m = ((fwd & 0x8000000000000000ULL) >> 30) | ((fwd & 0x100000000ULL) >> 32);
+        vec_t f = (((fwd << 1) & srol_keep) | m) ^ vin_f ^ vout_f;
+        // sror
+        vec_t x = rev ^ vin_r ^ vout_r;
+        m = ((x & 0x200000000ULL) << 30) | ((x & 1ULL) << 32);
+        vec_t r = ((x >> 1) & sror_keep) | m;
+        vec_t h = f + r;
+        fwd = f & vkeep;
+        rev = r & vkeep;
+        __builtin_memcpy(canonical, &h, sizeof(vec_t));
+        for (unsigned l = 0; l < L; ++l) {
+            if (not emit[l]) continue;
+            uint64_t h1 = canonical[l] * multiplier;
+            h1 ^= h1 >> nthash::MULTISHIFT;
+            buffer[2 * nkmers] = canonical[l];
+            buffer[2 * nkmers + 1] = h1;
+            if (++nkmers == MultiLaneNtHash::buffer_kmers) {
+                flush(buffer, nkmers);
+                nkmers = 0;
+            }
+        }
+    }
+    if (nkmers) flush(buffer, nkmers);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx512f"))) void 
+lanes_avx512(std::vector<std::string_view> const& batch, const uint16_t k, const uint64_t multiplier, MultiLaneNtHash::tables_t const& tab, uint64_t* buffer, MultiLaneNtHash::flush_t const& flush)
+{
+    lanes_kernel<8>(batch, k, multiplier, tab, buffer, flush);
+}
+
+__attribute__((target("avx2"))) void 
+lanes_avx2(std::vector<std::string_view> const& batch, const uint16_t k, const uint64_t multiplier, MultiLaneNtHash::tables_t const& tab, uint64_t* buffer, MultiLaneNtHash::flush_t const& flush)
+{
+    lanes_kernel<4>(batch, k, multiplier, tab, buffer, flush);
+}
+#endif
+
+void 
+lanes_generic(std::vector<std::string_view> const& batch, const uint16_t k, const uint64_t multiplier, MultiLaneNtHash::tables_t const& tab, uint64_t* buffer, MultiLaneNtHash::flush_t const& flush)
+{
+    lanes_kernel<4>(batch, k, multiplier, tab, buffer, flush);
+}
+
+} // namespace
+
+MultiLaneNtHash::MultiLaneNtHash(const uint16_t kmer_length)
+    : buffer(2 * buffer_kmers)
+{
+    reset(kmer_length);
+}
+
+void
+MultiLaneNtHash::reset(const uint16_t kmer_length) noexcept
+{
+    k = kmer_length;
+    multiplier = 1 ^ kmer_length * nthash::MULTISEED;
+    for (unsigned c = 0; c < 256; ++c) {
+        tables.fwd_in[c] = nthash::SEED_TAB[c];
+        tables.fwd_out[c] = nthash::srol_table(c, k);
+        tables.rev_in[c] = nthash::srol_table(c & nthash::CP_OFF, k);
+        tables.rev_out[c] = nthash::SEED_TAB[c & nthash::CP_OFF];
+    }
+}
+
+void
+MultiLaneNtHash::hash(std::vector<std::string_view> const& batch, flush_t const& flush)
+{
+#if defined(__x86_64__)
+    auto const& f = cpu::features();
+    if (f.avx512f) return lanes_avx512(batch, k, multiplier, tables, buffer.data(), flush);
+    if (f.avx2) return lanes_avx2(batch, k, multiplier, tables, buffer.data(), flush);
+#endif
+    lanes_generic(batch, k, multiplier, tables, buffer.data(), flush);
+}
+
+unsigned
+MultiLaneNtHash::lanes() noexcept
+{
+    return cpu::features().avx512f ? 8 : 4;
+}
+
+char const*
+MultiLaneNtHash::path() noexcept
+{
+    auto const& f = cpu::features();
+    return f.avx512f ? "avx512" : (f.avx2 ? "avx2" : "generic");
+}
+
+} // namespace sketching
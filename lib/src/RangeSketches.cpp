@@ -0,0 +1,119 @@
+#include "../include/RangeSketches.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace sketching {
+
+namespace {
+
+struct range_header_t {
+    char magic[8];
+    uint64_t block_records;
+    uint64_t nblocks;
+    uint64_t records;
+    uint64_t node_bytes;
+};
+
+constexpr char range_magic[8] = {'K', 'H', 'L', 'L', 'R', 'N', 'G', '2'};
+
+// nodes are written in the order they complete: after block t closes come (0, t), (1, t / 2)... 
+// so the nodes written before (h, j) are those completed by block t = (j + 1) 2^h - 1 excluded, and h more
+uint64_t node_position(const unsigned h, const uint64_t j) noexcept
+{
+    const uint64_t t = ((j + 1) << h) - 1;
+    uint64_t position = h;
+    for (uint64_t blocks = t; blocks; blocks >>= 1) position += blocks;
+    return position;
+}
+
+} // namespace
+
+RangeSketches::RangeSketches(std::string const& filename, const uint64_t block_records)
+    : filename(filename), ostrm(filename, std::ios::binary), block_records(block_records), records(0), nblocks(0), node_bytes(0)
+{
+    if (block_records == 0) throw std::invalid_argument("[RangeSketches] Blocks should hold at least one record");
+    if (not ostrm) throw std::runtime_error("[RangeSketches] Unable to write " + filename);
+    const range_header_t placeholder{}; // no magic until finish()
+    ostrm.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+}
+
+void
+RangeSketches::write(HyperLogLog const& node)
+{
+    const auto start = ostrm.tellp();
+    node.store(ostrm);
+    const uint64_t bytes = static_cast<uint64_t>(ostrm.tellp() - start);
+    if (node_bytes == 0) node_bytes = bytes;
+    if (not ostrm or bytes != node_bytes) throw std::runtime_error("[RangeSketches] Unable to write " + filename);
+}
+
+void
+RangeSketches::add_block(HyperLogLog const& block, const uint64_t nrecords)
+{
+    if (records % block_records != 0) throw std::invalid_argument("[add_block] Only the last block may be partial");
+    if (nrecords == 0 or nrecords > block_records) throw std::invalid_argument("[add_block] Wrong number of records in block");
+    // as a binary increment of nblocks: every set bit is a left child completed by its new sibling
+    HyperLogLog node = block;
+    write(node);
+    unsigned h = 0;
+    for (; (nblocks >> h) & 1; ++h) {
+        node = pending[h] + node;
+        write(node);
+    }
+    if (pending.size() <= h) pending.resize(h + 1);
+    pending[h] = std::move(node);
+    ++nblocks;
+    records += nrecords;
+}
+
+std::size_t
+RangeSketches::size() const noexcept
+{
+    return nblocks;
+}
+
+void
+RangeSketches::finish()
+{
+    range_header_t header;
+    std::memcpy(header.magic, range_magic, sizeof(range_magic));
+    header.block_records = block_records;
+    header.nblocks = nblocks;
+    header.records = records;
+    header.node_bytes = node_bytes;
+    ostrm.seekp(0);
+    ostrm.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ostrm.close();
+    if (not ostrm) throw std::runtime_error("[RangeSketches] Unable to write " + filename);
+    pending.clear();
+}
+
+RangeSketches::range_t
+RangeSketches::query(std::string const& filename, const uint64_t first, const uint64_t last)
+{
+    std::ifstream istrm(filename, std::ios::binary);
+    range_header_t header;
+    istrm.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (not istrm or std::memcmp(header.magic, range_magic, sizeof(range_magic)) != 0) throw std::runtime_error("[RangeSketches] " + filename + " is not a range sketch file");
+    if (first >= last or first >= header.records) throw std::invalid_argument("[query] Empty range of records");
+    uint64_t lo = first / header.block_records;
+    const uint64_t hi = std::min((std::min(last, header.records) + header.block_records - 1) / header.block_records, header.nblocks);
+    range_t result{lo * header.block_records, std::min(hi * header.block_records, header.records), HyperLogLog()};
+    bool empty = true;
+    while (lo < hi) { // largest aligned node starting at lo inside the range
+        unsigned h = 0;
+        while (lo % (uint64_t(2) << h) == 0 and lo + (uint64_t(2) << h) <= hi) ++h;
+        istrm.seekg(sizeof(header) + node_position(h, lo >> h) * header.node_bytes);
+        HyperLogLog node(istrm);
+        if (not istrm) throw std::runtime_error("[RangeSketches] Truncated range sketch file " + filename);
+        if (empty) result.sketch = std::move(node);
+        else result.sketch += node;
+        empty = false;
+        lo += uint64_t(1) << h;
+    }
+    return result;
+}
+
+} // namespace sketching
@@ -0,0 +1,63 @@
+#include "../include/RecordSketch.hpp"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace sketching {
+
+namespace {
+
+constexpr std::size_t max_b = 32; // touched registers are 32-bit indices
+
+} // namespace
+
+RecordSketch::RecordSketch(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend)
+    : b(msb_length), hasher(kmer_length, hash_backend)
+{
+    if (b < 1 or b > max_b) throw std::invalid_argument("[RecordSketch] Number of indexing bits should be in [1, " + std::to_string(max_b) + "]");
+    const std::size_t m = std::size_t(1) << b;
+    memory::check_budget(m);
+    registers.resize(m);
+}
+
+void
+RecordSketch::add(char const * const seq, const std::size_t length) noexcept
+{
+    hasher.for_each_hash(seq, length, [this](const uint64_t h0, const uint64_t h1) noexcept {
+        update(HyperLogLog::register_and_rank(h0, h1, b));
+    });
+}
+
+inline void
+RecordSketch::update(const RegisterRank update) noexcept
+{
+    auto& r = registers[update.index];
+    if (update.rank <= r) return;
+    if (r == 0) touched_registers.push_back(static_cast<uint32_t>(update.index));
+    r = update.rank;
+}
+
+void
+RecordSketch::clear() noexcept
+{
+    for (auto idx : touched_registers) registers[idx] = 0;
+    touched_registers.clear();
+}
+
+std::size_t
+RecordSketch::count() const noexcept
+{
+    // untouched registers add 2^0 each to the sum and are the zeros of linear counting
+    const std::size_t zeros = registers.size() - touched_registers.size();
+    double sum = static_cast<double>(zeros);
+    for (auto idx : touched_registers) sum += std::ldexp(1.0, -static_cast<int>(registers[idx]));
+    return HyperLogLog::estimate(sum, registers.size(), [zeros] { return zeros; });
+}
+
+std::size_t
+RecordSketch::touched() const noexcept
+{
+    return touched_registers.size();
+}
+
+} // namespace sketching
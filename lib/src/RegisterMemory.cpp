@@ -0,0 +1,190 @@
+#include "../include/RegisterMemory.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace sketching {
+
+namespace memory {
+
+namespace {
+
+constexpr std::size_t huge_page = std::size_t(1) << 21; // also the threshold for mapped blocks
+constexpr int mpol_preferred = 1; // linux/mempolicy.h, not every system ships numaif.h
+constexpr int mpol_interleave = 3;
+constexpr int mpol_f_mems_allowed = 4;
+
+std::atomic<std::size_t> allocated(0);
+
+std::size_t physical_memory() noexcept
+{
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 or page_size <= 0) return ~std::size_t(0);
+    return static_cast<std::size_t>(pages) * static_cast<std::size_t>(page_size);
+}
+
+std::size_t mapped_length(const std::size_t bytes) noexcept
+{
+    return (bytes + huge_page - 1) & ~(huge_page - 1);
+}
+
+void place(void* ptr, const std::size_t length, const int numa_node) noexcept
+{
+#if defined(SYS_mbind)
+    if (numa_node == -1) return;
+    unsigned long nodemask[16] = {}; // up to 1024 nodes
+    int mode = mpol_interleave;
+    if (numa_node == -2) { // every node this process may allocate from
+        if (syscall(SYS_get_mempolicy, nullptr, nodemask, 8 * sizeof(nodemask), nullptr, mpol_f_mems_allowed) != 0) return;
+    } else {
+        if (static_cast<std::size_t>(numa_node) >= 8 * sizeof(nodemask)) return;
+        nodemask[numa_node / (8 * sizeof(unsigned long))] = 1UL << (numa_node % (8 * sizeof(unsigned long)));
+        mode = mpol_preferred;
+    }
+    // best effort, the default policy is still correct
+    syscall(SYS_mbind, ptr, length, mode, nodemask, 8 * sizeof(nodemask), 0);
+#else
+    (void)ptr;
+    (void)length;
+    (void)numa_node;
+#endif
+}
+
+// huge_page-aligned anonymous mapping, nullptr on failure
+void* map_aligned(const std::size_t length, const bool hugetlb) noexcept
+{
+#if defined(MAP_HUGETLB)
+    if (hugetlb) {
+        void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) return ptr; // fails without enough reserved pages, fall back to normal pages
+    }
+#else
+    (void)hugetlb;
+#endif
+    const std::size_t padded = length + huge_page;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    const auto start = reinterpret_cast<std::uintptr_t>(raw);
+    const auto aligned = (start + huge_page - 1) & ~(huge_page - 1);
+    if (aligned > start) munmap(raw, aligned - start);
+    const std::size_t tail = start + padded - (aligned + length);
+    if (tail) munmap(reinterpret_cast<void*>(aligned + length), tail);
+    return reinterpret_cast<void*>(aligned);
+}
+
+} // namespace
+
+options_t& options() noexcept
+{
+    static options_t opts = {physical_memory(), HugePages::transparent, -1};
+    return opts;
+}
+
+namespace {
+
+[[noreturn]] void over_budget(const std::size_t bytes, const std::size_t used, const std::size_t budget)
+{
+    throw std::runtime_error(
+        "[memory] " + std::to_string(bytes) + " bytes of registers requested with " + std::to_string(used) + 
+        " already in use, over the memory budget of " + std::to_string(budget) + " bytes (lower b or raise the budget)"
+    );
+}
+
+} // namespace
+
+void check_budget(const std::size_t bytes)
+{
+    const std::size_t budget = options().budget;
+    const std::size_t used = allocated.load(std::memory_order_relaxed);
+    if (bytes > budget or used > budget - bytes) over_budget(bytes, used, budget);
+}
+
+void* allocate(const std::size_t bytes)
+{
+    // reserve before mapping, concurrent allocations cannot all pass the budget together
+    const std::size_t budget = options().budget;
+    std::size_t used = allocated.load(std::memory_order_relaxed);
+    do {
+        if (bytes > budget or used > budget - bytes) over_budget(bytes, used, budget);
+    } while (not allocated.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+    void* ptr = nullptr;
+    if (bytes < huge_page) {
+        ptr = std::calloc(bytes ? bytes : 1, 1);
+    } else {
+        auto const& opts = options();
+        const std::size_t length = mapped_length(bytes);
+        ptr = map_aligned(length, opts.huge_pages == HugePages::hugetlb);
+#if defined(MADV_HUGEPAGE)
+        if (ptr and opts.huge_pages != HugePages::off) madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+#if defined(MADV_NOHUGEPAGE)
+        if (ptr and opts.huge_pages == HugePages::off) madvise(ptr, length, MADV_NOHUGEPAGE);
+#endif
+        if (ptr) place(ptr, length, opts.numa_node);
+    }
+    if (not ptr) {
+        allocated.fetch_sub(bytes, std::memory_order_relaxed);
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void deallocate(void* ptr, const std::size_t bytes) noexcept
+{
+    if (not ptr) return;
+    if (bytes < huge_page) std::free(ptr);
+    else munmap(ptr, mapped_length(bytes));
+    allocated.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void zero(void* ptr, const std::size_t bytes) noexcept
+{
+    if (bytes < huge_page) {
+        std::memset(ptr, 0, bytes);
+        return;
+    }
+    // private anonymous pages read back as zero after MADV_DONTNEED
+    if (madvise(ptr, mapped_length(bytes), MADV_DONTNEED) != 0) std::memset(ptr, 0, bytes);
+}
+
+std::size_t parse_size(std::string const& size)
+{
+    std::size_t pos = 0;
+    const std::size_t value = std::stoull(size, &pos);
+    if (pos == size.size()) return value;
+    if (pos + 1 != size.size()) throw std::invalid_argument("invalid size " + size);
+    switch (size[pos]) {
+        case 'k': case 'K': return value << 10;
+        case 'm': case 'M': return value << 20;
+        case 'g': case 'G': return value << 30;
+        case 't': case 'T': return value << 40;
+        default: throw std::invalid_argument("invalid size " + size);
+    }
+}
+
+HugePages huge_pages_from_string(std::string const& name)
+{
+    if (name == "off") return HugePages::off;
+    if (name == "thp") return HugePages::transparent;
+    if (name == "hugetlb") return HugePages::hugetlb;
+    throw std::invalid_argument("unknown huge page mode " + name + " (off, thp or hugetlb)");
+}
+
+int numa_from_string(std::string const& name)
+{
+    if (name == "none") return -1;
+    if (name == "interleave") return -2;
+    std::size_t pos = 0;
+    const int node = std::stoi(name, &pos);
+    if (pos != name.size() or node < 0) throw std::invalid_argument("unknown NUMA placement " + name + " (none, interleave or a node number)");
+    return node;
+}
+
+} // namespace memory
+
+} // namespace sketching
@@ -0,0 +1,81 @@
+#include "../include/SlidingHyperLogLog.hpp"
+#include "../include/RegisterMemory.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace sketching {
+
+namespace {
+
+constexpr std::size_t rank_bits = 8;
+constexpr uint64_t rank_mask = (uint64_t(1) << rank_bits) - 1;
+constexpr uint64_t max_timestamp = (uint64_t(1) << (64 - rank_bits)) - 1;
+
+} // namespace
+
+SlidingHyperLogLog::SlidingHyperLogLog(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend, const uint64_t max_window)
+    : b(msb_length), max_window(max_window), now(0), hasher(kmer_length, hash_backend)
+{
+    HyperLogLog::sanitize_b(b); // before shifting by b
+    if (max_window == 0) throw std::invalid_argument("[SlidingHyperLogLog] Window should be positive");
+    const std::size_t m = std::size_t(1) << b;
+    memory::check_budget(m * sizeof(list_t));
+    lists.resize(m);
+}
+
+void
+SlidingHyperLogLog::advance(const uint64_t timestamp)
+{
+    if (timestamp < now) throw std::invalid_argument("[advance] Time cannot go back");
+    if (timestamp > max_timestamp) throw std::invalid_argument("[advance] Timestamp too large");
+    now = timestamp;
+}
+
+void
+SlidingHyperLogLog::add(char const * const seq, const std::size_t length)
+{
+    hasher.for_each_hash(seq, length, [this](const uint64_t h0, const uint64_t h1) {
+        update(HyperLogLog::register_and_rank(h0, h1, b));
+    });
+}
+
+uint64_t
+SlidingHyperLogLog::time() const noexcept
+{
+    return now;
+}
+
+inline void
+SlidingHyperLogLog::update(const RegisterRank update)
+{
+    const uint64_t rank = update.rank;
+    auto& list = lists[update.index];
+    while (not list.empty() and (list.back() & rank_mask) <= rank) list.pop_back(); // older and not larger
+    std::size_t expired = 0;
+    while (expired < list.size() and (list[expired] >> rank_bits) + max_window <= now) ++expired;
+    if (expired) list.erase(list.begin(), list.begin() + expired);
+    list.push_back(now << rank_bits | rank);
+}
+
+HyperLogLog
+SlidingHyperLogLog::snapshot(uint64_t window) const
+{
+    window = std::min(window, max_window);
+    std::vector<uint8_t> registers(lists.size(), 0);
+    for (std::size_t i = 0; i < lists.size(); ++i) {
+        for (auto entry : lists[i]) { // the first pair inside the window has the largest rank
+            if ((entry >> rank_bits) + window <= now) continue;
+            registers[i] = static_cast<uint8_t>(entry & rank_mask);
+            break;
+        }
+    }
+    return HyperLogLog(hasher.kmer_length(), b, hasher.hash_backend(), registers.data(), 0);
+}
+
+std::size_t
+SlidingHyperLogLog::count(const uint64_t window) const
+{
+    return snapshot(window).count();
+}
+
+} // namespace sketching
@@ -0,0 +1,67 @@
+#include "../include/SpectrumSketch.hpp"
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace sketching {
+
+SpectrumSketch::SpectrumSketch(const std::size_t capacity)
+    : capacity(capacity), threshold(std::numeric_limits<uint64_t>::max())
+{
+    if (capacity == 0) throw std::invalid_argument("[SpectrumSketch] capacity should be > 0");
+    counts.reserve(capacity + 1);
+}
+
+void
+SpectrumSketch::insert(const uint64_t hash) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t t = threshold.load(std::memory_order_relaxed);
+    if (hash > t) return; // lowered meanwhile
+    auto& count = counts[hash];
+    if (count < std::numeric_limits<uint32_t>::max()) ++count;
+    while (counts.size() > capacity and t) {
+        t >>= 1;
+        for (auto itr = counts.begin(); itr != counts.end();) {
+            if (itr->first > t) itr = counts.erase(itr);
+            else ++itr;
+        }
+    }
+    threshold.store(t, std::memory_order_relaxed);
+}
+
+double
+SpectrumSketch::fraction() const noexcept
+{
+    // threshold is 2^j - 1, the sampled fraction is 2^(j - 64)
+    return (static_cast<double>(threshold.load(std::memory_order_relaxed)) + 1) / 18446744073709551616.0;
+}
+
+std::size_t
+SpectrumSketch::sampled() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counts.size();
+}
+
+std::map<uint32_t, double>
+SpectrumSketch::spectrum() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const double scale = 1.0 / fraction();
+    std::map<uint32_t, double> histogram;
+    for (auto const& [hash, count] : counts) histogram[count] += scale;
+    return histogram;
+}
+
+void
+SpectrumSketch::store(std::string const& filename) const
+{
+    std::ofstream ostrm(filename);
+    ostrm << "# sampled fraction " << fraction() << " (" << sampled() << " k-mers)\n";
+    ostrm << "abundance\tkmers\n";
+    for (auto const& [abundance, kmers] : spectrum()) ostrm << abundance << "\t" << static_cast<std::size_t>(kmers + 0.5) << "\n";
+    if (not ostrm) throw std::runtime_error("unable to write spectrum " + filename);
+}
+
+} // namespace sketching
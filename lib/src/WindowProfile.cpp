@@ -0,0 +1,84 @@
+#include "../include/WindowProfile.hpp"
+#include "../include/RegisterMemory.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace sketching {
+
+namespace {
+
+constexpr std::size_t max_b = 16; // windows are small, many sketches are alive at once
+
+} // namespace
+
+WindowProfile::WindowProfile(const uint8_t kmer_length, const uint8_t msb_length, const HashBackend hash_backend, const std::size_t window, const std::size_t step)
+    : b(msb_length), m(std::size_t(1) << msb_length), window(window), step(step), hasher(kmer_length, hash_backend)
+{
+    if (b == 0 or b > max_b) throw std::invalid_argument("[WindowProfile] Number of indexing bits should be in [1, " + std::to_string(max_b) + "]");
+    if (step == 0 or window < step or window % step != 0) throw std::invalid_argument("[WindowProfile] Window size should be a positive multiple of the step");
+    const std::size_t nslots = window / step;
+    memory::check_budget(nslots * m);
+    registers.resize(nslots * m);
+    slots.resize(nslots);
+    for (std::size_t s = 0; s < nslots; ++s) reset(s);
+    for (std::size_t r = 0; r < inverse_powers.size(); ++r) inverse_powers[r] = std::ldexp(1.0, -static_cast<int>(r));
+}
+
+std::vector<window_t>
+WindowProfile::profile(char const * const seq, const std::size_t length)
+{
+    // k-mers are hashed one step at a time, those starting in bin j belong to windows j - window / step + 1 .. j
+    const std::size_t overlap = hasher.kmer_length() - 1;
+    if (length <= overlap) return {};
+    const std::size_t kmers = length - overlap; // k-mer starts
+    const std::size_t per_window = slots.size();
+    const std::size_t nwindows = kmers <= window ? 1 : (kmers - window + step - 1) / step + 1;
+    std::vector<window_t> windows;
+    windows.reserve(nwindows);
+    auto close = [&](const std::size_t i) {
+        const auto slot = i % per_window;
+        const std::size_t end = i + 1 == nwindows ? length : i * step + window;
+        windows.push_back({i * step, end, static_cast<std::size_t>(slots[slot].estimate + 0.5)});
+        reset(slot);
+    };
+    auto update_active = [this](const uint64_t h0, const uint64_t h1) noexcept { update(HyperLogLog::register_and_rank(h0, h1, b)); };
+    for (std::size_t j = 0; j * step < kmers; ++j) {
+        const std::size_t first = j + 1 >= per_window ? j + 1 - per_window : 0;
+        const std::size_t last = std::min(j, nwindows - 1);
+        active.clear();
+        for (std::size_t i = first; i <= last; ++i) active.push_back(i % per_window);
+        const std::size_t start = j * step;
+        hasher.for_each_hash(seq + start, std::min(step + overlap, length - start), update_active);
+        if (j + 1 >= per_window and first < nwindows) close(first);
+    }
+    while (windows.size() < nwindows) close(windows.size());
+    return windows;
+}
+
+inline void
+WindowProfile::update(const RegisterRank update) noexcept
+{
+    for (auto s : active) {
+        auto& r = registers[s * m + update.index];
+        if (update.rank <= r) continue;
+        auto& slot = slots[s];
+        slot.estimate += m / slot.inverse_sum; // 1 / probability that a new k-mer changes the sketch
+        slot.inverse_sum += inverse_powers[update.rank] - inverse_powers[r];
+        if (r == 0) slot.touched.push_back(static_cast<uint32_t>(update.index));
+        r = update.rank;
+    }
+}
+
+void
+WindowProfile::reset(const std::size_t s) noexcept
+{
+    auto& slot = slots[s];
+    for (auto idx : slot.touched) registers[s * m + idx] = 0;
+    slot.touched.clear();
+    slot.estimate = 0;
+    slot.inverse_sum = static_cast<double>(m);
+}
+
+} // namespace sketching
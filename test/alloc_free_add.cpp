@@ -0,0 +1,64 @@
+// The add paths of the build loop make no heap allocation per record once warmed up.
+#include "common.hpp"
+#include "../lib/include/HyperLogLog.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::atomic<std::size_t> allocations(0);
+
+void* counted_malloc(std::size_t n)
+{
+    ++allocations;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(std::size_t n) { return counted_malloc(n); }
+void* operator new[](std::size_t n) { return counted_malloc(n); }
+void* operator new(std::size_t n, std::nothrow_t const&) noexcept { ++allocations; return std::malloc(n ? n : 1); }
+void* operator new[](std::size_t n, std::nothrow_t const&) noexcept { ++allocations; return std::malloc(n ? n : 1); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+int main()
+{
+    using namespace sketching;
+    std::mt19937_64 rng(37);
+    std::vector<std::string> records;
+    for (std::size_t i = 0; i < 256; ++i) records.push_back(test::random_sequence(rng, 80 + rng() % 200, i % 3 ? 0 : 97));
+    records.push_back(test::random_sequence(rng, 1 << 17)); // long records take the in-place path of the batch add
+    std::vector<std::string_view> batch(records.begin(), records.end());
+    const std::vector<std::string> seeds = {"1111011111111111111111111101111", "1101111111111111111111111111011"};
+
+    HyperLogLog fixed_k(31, uint8_t(12));
+    HyperLogLog any_k(27, uint8_t(12));
+    HyperLogLog packed(21, uint8_t(12), HashBackend::packed);
+    std::vector<HyperLogLog> seeded(seeds.size(), HyperLogLog(31, uint8_t(12)));
+
+    auto add_all = [&]() {
+        for (auto const& r : records) {
+            fixed_k.add(r.data(), r.size());
+            any_k.add(r.data(), r.size());
+            packed.add(r.data(), r.size());
+            HyperLogLog::add(seeded, seeds, r.data(), r.size());
+        }
+        fixed_k.add(batch);
+        any_k.add(batch);
+        packed.add(batch);
+    };
+    add_all(); // warm-up: per-thread hashers and buffers
+    const std::size_t before = allocations.load();
+    for (std::size_t round = 0; round < 4; ++round) add_all();
+    const std::size_t per_pass = allocations.load() - before;
+    test::expect(per_pass == 0, "add() allocated " + std::to_string(per_pass) + " times after warm-up");
+    return test::result();
+}
@@ -0,0 +1,53 @@
+// Per-barcode sketches equal the sketch of the same reads built alone, sparse or dense.
+#include "common.hpp"
+#include "../lib/include/BarcodeSketches.hpp"
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+std::string bytes(sketching::HyperLogLog const& hll)
+{
+    std::ostringstream ostrm;
+    hll.store(ostrm);
+    return ostrm.str();
+}
+
+} // namespace
+
+int main()
+{
+    using namespace sketching;
+    std::mt19937_64 rng(46);
+    const std::vector<std::string> barcodes = {"AAAC", "CCGT", "GGTA", "TTAC"};
+    const std::vector<std::size_t> reads_per_barcode = {2, 40, 400, 3000}; // from sparse only to dense
+    for (uint8_t b : {uint8_t(10), uint8_t(16)}) {
+        BarcodeSketches sketches(31, b, HashBackend::nthash);
+        std::vector<HyperLogLog> alone(barcodes.size(), HyperLogLog(31, b));
+        for (std::size_t round = 0; round < 3000; ++round) { // interleaved barcodes
+            for (std::size_t i = 0; i < barcodes.size(); ++i) {
+                if (round >= reads_per_barcode[i]) continue;
+                const auto read = test::random_sequence(rng, 150, round % 5 ? 0 : 61);
+                sketches.add(barcodes[i], read.data(), read.size());
+                alone[i].add(read.data(), read.size());
+            }
+        }
+        test::expect(sketches.size() == barcodes.size(), "one sketch per barcode");
+        for (std::size_t i = 0; i < sketches.size(); ++i) {
+            test::expect(sketches.barcode(i) == barcodes[i], "barcodes in order of appearance");
+            test::expect(sketches.reads(i) == reads_per_barcode[i], "reads per barcode");
+            test::expect(bytes(sketches.sketch(i)) == bytes(alone[i]), "b=" + std::to_string(b) + " barcode " + barcodes[i] + " matches its sketch built alone");
+        }
+        const std::string filename = "test_barcode_sketches.khd";
+        sketches.store(filename);
+        const auto loaded = BarcodeSketches::load(filename);
+        std::remove(filename.c_str());
+        test::expect(loaded.size() == barcodes.size(), "all barcodes stored");
+        for (std::size_t i = 0; i < loaded.size(); ++i) {
+            test::expect(loaded[i].barcode == barcodes[i] and loaded[i].reads == reads_per_barcode[i], "stored barcode and reads");
+            test::expect(bytes(loaded[i].sketch) == bytes(alone[i]), "stored sketch");
+        }
+    }
+    return test::result();
+}
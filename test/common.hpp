@@ -0,0 +1,37 @@
+#ifndef KHLL_TEST_COMMON_HPP
+#define KHLL_TEST_COMMON_HPP
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace test {
+
+inline int failures = 0;
+
+inline void expect(const bool condition, std::string const& what)
+{
+    if (condition) return;
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+}
+
+// uniform ACGT, with an N every n_every bases when n_every > 0
+inline std::string random_sequence(std::mt19937_64& rng, const std::size_t length, const std::size_t n_every = 0)
+{
+    static constexpr char bases[] = "ACGT";
+    std::string seq(length, 'A');
+    for (std::size_t i = 0; i < length; ++i) seq[i] = (n_every and i % n_every == n_every - 1) ? 'N' : bases[rng() & 3];
+    return seq;
+}
+
+inline int result()
+{
+    if (failures) std::cerr << failures << " check(s) failed\n";
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+} // namespace test
+
+#endif // KHLL_TEST_COMMON_HPP
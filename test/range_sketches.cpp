@@ -0,0 +1,59 @@
+// Range queries equal the direct union of the blocks they cover, the whole input equals the final sketch.
+#include "common.hpp"
+#include "../lib/include/RangeSketches.hpp"
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+std::string bytes(sketching::HyperLogLog const& hll)
+{
+    std::ostringstream ostrm;
+    hll.store(ostrm);
+    return ostrm.str();
+}
+
+} // namespace
+
+int main()
+{
+    using namespace sketching;
+    std::mt19937_64 rng(50);
+    const std::string filename = "test_range_sketches.rng";
+    const uint64_t block_records = 4;
+    for (std::size_t nrecords : {1, 4, 5, 31, 64, 150}) { // partial last blocks and full trees
+        std::vector<std::string> reads;
+        for (std::size_t i = 0; i < nrecords; ++i) reads.push_back(i % 3 == 2 ? reads[i / 2] : test::random_sequence(rng, 80, 0));
+        HyperLogLog whole(31, uint8_t(10));
+        {
+            RangeSketches ranges(filename, block_records);
+            HyperLogLog block(31, uint8_t(10));
+            for (std::size_t i = 0; i < nrecords; ++i) {
+                block.add(reads[i].data(), reads[i].size());
+                whole.add(reads[i].data(), reads[i].size());
+                if ((i + 1) % block_records == 0 or i + 1 == nrecords) {
+                    ranges.add_block(block, (i % block_records) + 1);
+                    block.reset();
+                }
+            }
+            test::expect(ranges.size() == (nrecords + block_records - 1) / block_records, "one node per block");
+            ranges.finish();
+        }
+        const auto all = RangeSketches::query(filename, 0, std::numeric_limits<uint64_t>::max());
+        test::expect(all.first == 0 and all.last == nrecords, "the whole input is covered");
+        test::expect(bytes(all.sketch) == bytes(whole), std::to_string(nrecords) + " records: the whole range is the final sketch");
+        for (std::size_t q = 0; q < 50; ++q) {
+            const uint64_t first = rng() % nrecords;
+            const uint64_t last = first + 1 + rng() % (nrecords - first);
+            const auto range = RangeSketches::query(filename, first, last);
+            test::expect(range.first == first / block_records * block_records and range.first <= first and range.last >= last, "ranges are widened to whole blocks");
+            HyperLogLog direct(31, uint8_t(10));
+            for (uint64_t i = range.first; i < range.last; ++i) direct.add(reads[i].data(), reads[i].size());
+            test::expect(bytes(range.sketch) == bytes(direct), std::to_string(nrecords) + " records: range [" + std::to_string(first) + ", " + std::to_string(last) + ") is the union of its blocks");
+        }
+    }
+    std::remove(filename.c_str());
+    return test::result();
+}
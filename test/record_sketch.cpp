@@ -0,0 +1,28 @@
+// RecordSketch estimates each record as a HyperLogLog built from that record alone.
+#include "common.hpp"
+#include "../lib/include/RecordSketch.hpp"
+#include <stdexcept>
+
+int main()
+{
+    using namespace sketching;
+    std::mt19937_64 rng(47);
+    for (uint8_t b : {uint8_t(1), uint8_t(8), uint8_t(14)}) {
+        RecordSketch sketch(31, b, HashBackend::nthash);
+        for (std::size_t length : {10, 31, 200, 5000, 100000}) { // linear counting and raw estimates
+            const auto record = test::random_sequence(rng, length, 97);
+            HyperLogLog alone(31, b);
+            alone.add(record.data(), record.size());
+            sketch.add(record.data(), record.size());
+            test::expect(sketch.count() == alone.count(), "b=" + std::to_string(b) + " length " + std::to_string(length) + " estimate");
+            sketch.clear();
+            test::expect(sketch.touched() == 0 and sketch.count() == 0, "clear() empties the sketch");
+        }
+    }
+    for (uint8_t b : {uint8_t(0), uint8_t(33)}) {
+        bool thrown = false;
+        try { RecordSketch(31, b, HashBackend::nthash); } catch (std::invalid_argument const&) { thrown = true; }
+        test::expect(thrown, "b=" + std::to_string(b) + " is refused");
+    }
+    return test::result();
+}
@@ -0,0 +1,53 @@
+// Concurrent register allocations never exceed the memory budget together.
+#include "common.hpp"
+#include "../lib/include/RegisterMemory.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+int main()
+{
+    using namespace sketching;
+    constexpr std::size_t block = std::size_t(1) << 16;
+    constexpr std::size_t fitting = 24;
+    constexpr std::size_t nthreads = 8;
+    memory::options().budget = fitting * block;
+
+    for (std::size_t round = 0; round < 50; ++round) {
+        std::atomic<bool> go(false);
+        std::vector<std::vector<void*>> owned(nthreads);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&, t]() {
+                while (not go.load()) {}
+                for (std::size_t i = 0; i < fitting; ++i) {
+                    try {
+                        owned[t].push_back(memory::allocate(block));
+                    } catch (std::runtime_error const&) {
+                        break;
+                    }
+                }
+            });
+        }
+        go = true;
+        for (auto& t : threads) t.join();
+        std::size_t total = 0;
+        for (auto const& ptrs : owned) total += ptrs.size();
+        test::expect(total == fitting, "round " + std::to_string(round) + ": " + std::to_string(total) + " blocks allocated for a budget of " + std::to_string(fitting));
+        for (auto const& ptrs : owned) {
+            for (auto ptr : ptrs) memory::deallocate(ptr, block);
+        }
+    }
+
+    bool thrown = false;
+    try {
+        memory::allocate((fitting + 1) * block);
+    } catch (std::runtime_error const&) {
+        thrown = true;
+    }
+    test::expect(thrown, "a block larger than the budget is refused");
+    void* all = memory::allocate(fitting * block); // everything was given back
+    memory::deallocate(all, fitting * block);
+    return test::result();
+}
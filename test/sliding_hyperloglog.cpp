@@ -0,0 +1,48 @@
+// A sliding window snapshot has the registers of a sketch rebuilt from the reads inside the window.
+#include "common.hpp"
+#include "../lib/include/SlidingHyperLogLog.hpp"
+#include <deque>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// registers only, the snapshot has no total k-mers
+std::string registers(sketching::HyperLogLog const& hll)
+{
+    std::ostringstream ostrm;
+    hll.store(ostrm);
+    return ostrm.str().substr(4 + sizeof(std::size_t)); // magic, backend, k, b, total
+}
+
+} // namespace
+
+int main()
+{
+    using namespace sketching;
+    std::mt19937_64 rng(49);
+    const uint64_t max_window = 300;
+    SlidingHyperLogLog sliding(31, 10, HashBackend::nthash, max_window);
+    std::deque<std::string> recent; // the last max_window reads
+    for (uint64_t t = 1; t <= 1000; ++t) { // one read per time unit
+        // a read seen twice keeps its k-mers in the window from the second time
+        const auto read = t % 7 == 0 and recent.size() > 50 ? recent[recent.size() - 50] : test::random_sequence(rng, 100, 0);
+        sliding.advance(t);
+        sliding.add(read.data(), read.size());
+        recent.push_back(read);
+        if (recent.size() > max_window) recent.pop_front();
+        if (t % 97 != 0 and t != 1000) continue;
+        for (uint64_t w : {uint64_t(1), uint64_t(10), uint64_t(150), max_window, max_window + 100}) {
+            HyperLogLog rebuilt(31, uint8_t(10));
+            const std::size_t nreads = std::min<std::size_t>(std::min(w, max_window), recent.size());
+            for (std::size_t i = recent.size() - nreads; i < recent.size(); ++i) rebuilt.add(recent[i].data(), recent[i].size());
+            test::expect(registers(sliding.snapshot(w)) == registers(rebuilt), "t=" + std::to_string(t) + " window " + std::to_string(w) + " matches the rebuilt sketch");
+        }
+    }
+    for (uint8_t b : {uint8_t(0), uint8_t(56), uint8_t(64)}) {
+        bool thrown = false;
+        try { SlidingHyperLogLog(31, b, HashBackend::nthash, 10); } catch (std::invalid_argument const&) { thrown = true; }
+        test::expect(thrown, "b=" + std::to_string(b) + " is refused");
+    }
+    return test::result();
+}
@@ -0,0 +1,59 @@
+// Window estimates against exact distinct k-mer counts, and records without k-mers.
+#include "common.hpp"
+#include "../lib/include/WindowProfile.hpp"
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <utility>
+
+namespace {
+
+// distinct k-mers starting in [start, end) of the sequence
+std::size_t exact_count(std::string const& seq, const uint8_t k, const std::size_t start, const std::size_t end)
+{
+    std::set<std::pair<uint64_t, uint64_t>> hashes;
+    const std::size_t last = std::min(end + k - 1, seq.size());
+    sketching::for_each_kmer_hash(seq.data() + start, last - start, k, sketching::HashBackend::nthash, [&](const uint64_t h0, const uint64_t h1) {
+        hashes.emplace(h0, h1);
+    });
+    return hashes.size();
+}
+
+} // namespace
+
+int main()
+{
+    using namespace sketching;
+    std::mt19937_64 rng(48);
+    const uint8_t k = 31;
+    // random sequence with a tandem repeat in the middle, so some windows hold few distinct k-mers
+    auto seq = test::random_sequence(rng, 100000, 0);
+    const auto unit = seq.substr(40000, 500);
+    for (std::size_t i = 0; i < 30; ++i) std::copy(unit.begin(), unit.end(), seq.begin() + 40000 + i * unit.size());
+
+    for (uint8_t b : {uint8_t(8), uint8_t(12)}) {
+        WindowProfile profile(k, b, HashBackend::nthash, 10000, 1000);
+        const auto windows = profile.profile(seq.data(), seq.size());
+        test::expect(windows.size() == 91, "windows start every step until the last k-mer");
+        double squared_errors = 0;
+        for (std::size_t i = 0; i < windows.size(); ++i) {
+            test::expect(windows[i].start == i * 1000 and windows[i].start < windows[i].end, "window bounds");
+            const double exact = static_cast<double>(exact_count(seq, k, windows[i].start, windows[i].end));
+            const double error = (windows[i].estimate - exact) / exact;
+            squared_errors += error * error;
+        }
+        test::expect(windows.back().end == seq.size(), "the last window ends with the sequence");
+        const double rmse = std::sqrt(squared_errors / windows.size());
+        const double expected = 0.83 / std::sqrt(static_cast<double>(std::size_t(1) << b));
+        test::expect(rmse < 1.5 * expected, "b=" + std::to_string(b) + " relative RMSE " + std::to_string(rmse) + " within 1.5x of " + std::to_string(expected));
+    }
+
+    WindowProfile profile(k, 8, HashBackend::nthash, 1000, 500);
+    test::expect(profile.profile(seq.data(), 0).empty(), "an empty record has no window");
+    test::expect(profile.profile(seq.data(), k - 1).empty(), "a record shorter than k has no window");
+    const auto single = profile.profile(seq.data(), k);
+    test::expect(single.size() == 1 and single[0].start == 0 and single[0].end == k and single[0].estimate == 1, "a record of length k has one window with one k-mer");
+    const auto tail = profile.profile(seq.data(), 1000 + k - 1); // 1000 k-mers, the last window would start past them
+    test::expect(tail.size() == 1 and tail[0].end == 1000 + k - 1, "no window without k-mer starts");
+    return test::result();
+}